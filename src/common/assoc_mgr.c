@@ -50,14 +50,21 @@
 #include "src/common/slurmdbd_pack.h"
 #include "src/slurmdbd/read_config.h"
 
-#define ASSOC_HASH_SIZE 1000
-#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define ASSOC_HASH_SIZE 1000	/* Minimum size of association hash tables */
+#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % assoc_hash_size)
+#define REC_INDEX_SIZE 256	/* Minimum size of user/QOS/wckey indexes */
+
+/* assoc_usage_journal record types */
+#define USAGE_JOURNAL_ASSOC 1	/* Usage of one user association */
+#define USAGE_JOURNAL_DECAY 2	/* Usage of all associations decayed */
 
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
 uint32_t g_qos_count = 0;
 uint32_t g_user_assoc_count = 0;
 uint32_t g_tres_count = 0;
+uint32_t g_assoc_usage_gen = 0;
+uint32_t g_qos_update_gen = 0;
 
 List assoc_mgr_tres_list = NULL;
 slurmdb_tres_rec_t **assoc_mgr_tres_array = NULL;
@@ -76,8 +83,83 @@ static pthread_rwlock_t assoc_mgr_locks[ASSOC_MGR_ENTITY_COUNT]
 static assoc_init_args_t init_setup;
 static slurmdb_assoc_rec_t **assoc_hash_id = NULL;
 static slurmdb_assoc_rec_t **assoc_hash = NULL;
+static int assoc_hash_cnt = 0;	/* Associations in the hash tables */
+static int assoc_hash_size = 0;	/* Buckets in each hash table */
 static int *assoc_mgr_tres_old_pos = NULL;
 
+/*
+ * Association usage is saved as a full assoc_usage snapshot followed by
+ * an assoc_usage_journal holding a record for each decay of all usage
+ * and one for each association whose usage changed otherwise since. The
+ * journal is compacted into a new snapshot once it holds more records
+ * than the snapshot itself. Protected by the file lock.
+ */
+static time_t usage_snapshot_time = 0;	/* Time of assoc_usage snapshot */
+static bool usage_journal_valid = false; /* Journal follows the snapshot */
+static int usage_journal_recs = 0;	/* Records appended since */
+
+/*
+ * Chained hash index over the records of one of the assoc_mgr Lists so
+ * user, QOS and wckey lookups need not walk the whole List. Entries are
+ * appended to the tail of their bucket so a lookup returns the same
+ * record a walk of the List in order would.
+ */
+typedef struct rec_index_ent {
+	void *rec;
+	struct rec_index_ent *next;
+} rec_index_ent_t;
+
+typedef struct {
+	uint32_t (*key_f)(void *rec);	/* Hash key of a record */
+	rec_index_ent_t **hash;
+	int cnt;	/* Records in the index */
+	int size;	/* Buckets in hash */
+} rec_index_t;
+
+static uint32_t _user_uid_key(void *rec);
+static uint32_t _user_name_key(void *rec);
+static uint32_t _qos_id_key(void *rec);
+static uint32_t _qos_name_key(void *rec);
+static uint32_t _wckey_id_key(void *rec);
+static uint32_t _wckey_user_name_key(void *rec);
+
+static rec_index_t user_uid_index = { .key_f = _user_uid_key };
+static rec_index_t user_name_index = { .key_f = _user_name_key };
+static rec_index_t qos_id_index = { .key_f = _qos_id_key };
+static rec_index_t qos_name_index = { .key_f = _qos_name_key };
+static rec_index_t wckey_id_index = { .key_f = _wckey_id_key };
+static rec_index_t wckey_index = { .key_f = _wckey_user_name_key };
+
+/*
+ * Usage of a user association as last written to the assoc_usage state,
+ * decayed the same way as the association since. Any other change to the
+ * association's usage makes them differ, so it must be journaled.
+ */
+typedef struct {
+	uint32_t assoc_id;
+	double grp_used_wall;
+	long double usage_raw;
+	long double *usage_tres_raw;
+	int tres_cnt;		/* Elements in usage_tres_raw */
+} usage_saved_t;
+
+/* A decay of the usage of all associations not journaled yet */
+typedef struct {
+	time_t decay_time;
+	double factor;
+} usage_decay_t;
+
+static uint32_t _usage_saved_id_key(void *rec);
+static void _free_usage_saved(void);
+
+/*
+ * Protected by the assoc write lock, or by the assoc read lock together
+ * with the file write lock.
+ */
+static rec_index_t usage_saved_index = { .key_f = _usage_saved_id_key };
+static usage_decay_t *usage_decay = NULL;
+static int usage_decay_cnt = 0;
+
 static bool _running_cache(void)
 {
 	if (init_setup.running_cache && *init_setup.running_cache)
@@ -121,25 +203,76 @@ static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
 	if (assoc->partition)
 		index += _get_str_inx(assoc->partition);
 
-	index %= ASSOC_HASH_SIZE;
+	index %= assoc_hash_size;
 	if (index < 0)
-		index += ASSOC_HASH_SIZE;
+		index += assoc_hash_size;
 
 	return index;
 
 }
 
+/* Allocate empty association hash tables sized for assoc_cnt records */
+static void _alloc_assoc_hash(int assoc_cnt)
+{
+	xfree(assoc_hash_id);
+	xfree(assoc_hash);
+	assoc_hash_size = MAX(assoc_cnt, ASSOC_HASH_SIZE);
+	assoc_hash_id = xmalloc(assoc_hash_size *
+				sizeof(slurmdb_assoc_rec_t *));
+	assoc_hash = xmalloc(assoc_hash_size * sizeof(slurmdb_assoc_rec_t *));
+	assoc_hash_cnt = 0;
+}
+
+/*
+ * Double the size of the association hash tables so the chains walked by
+ * every lookup, while holding the assoc_mgr lock, stay short as
+ * associations are added. Each new bucket takes its records from a single
+ * old bucket, so appending them in order preserves the search order.
+ */
+static void _grow_assoc_hash(void)
+{
+	slurmdb_assoc_rec_t **old_hash_id = assoc_hash_id;
+	slurmdb_assoc_rec_t **old_hash = assoc_hash;
+	slurmdb_assoc_rec_t *assoc, **tail;
+	int i, old_size = assoc_hash_size, old_cnt = assoc_hash_cnt;
+
+	assoc_hash_id = assoc_hash = NULL;
+	_alloc_assoc_hash(old_size * 2);
+	assoc_hash_cnt = old_cnt;
+
+	for (i = 0; i < old_size; i++) {
+		while ((assoc = old_hash_id[i])) {
+			old_hash_id[i] = assoc->assoc_next_id;
+			assoc->assoc_next_id = NULL;
+			tail = &assoc_hash_id[ASSOC_HASH_ID_INX(assoc->id)];
+			while (*tail)
+				tail = &(*tail)->assoc_next_id;
+			*tail = assoc;
+		}
+		while ((assoc = old_hash[i])) {
+			old_hash[i] = assoc->assoc_next;
+			assoc->assoc_next = NULL;
+			tail = &assoc_hash[_assoc_hash_index(assoc)];
+			while (*tail)
+				tail = &(*tail)->assoc_next;
+			*tail = assoc;
+		}
+	}
+	xfree(old_hash_id);
+	xfree(old_hash);
+}
+
 static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 {
-	int inx = ASSOC_HASH_ID_INX(assoc->id);
+	int inx;
 
-	if (!assoc_hash_id)
-		assoc_hash_id = xmalloc(ASSOC_HASH_SIZE *
-				     sizeof(slurmdb_assoc_rec_t *));
-	if (!assoc_hash)
-		assoc_hash = xmalloc(ASSOC_HASH_SIZE *
-				     sizeof(slurmdb_assoc_rec_t *));
+	if (!assoc_hash_id || !assoc_hash)
+		_alloc_assoc_hash(ASSOC_HASH_SIZE);
+	else if (assoc_hash_cnt >= assoc_hash_size)
+		_grow_assoc_hash();
+	assoc_hash_cnt++;
 
+	inx = ASSOC_HASH_ID_INX(assoc->id);
 	assoc->assoc_next_id = assoc_hash_id[inx];
 	assoc_hash_id[inx] = assoc;
 
@@ -316,6 +449,365 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 		return;	/* Fix CLANG false positive error */
 	} else
 		*assoc_pptr = assoc_ptr->assoc_next;
+
+	assoc_hash_cnt--;
+}
+
+static uint32_t _user_uid_key(void *rec)
+{
+	return ((slurmdb_user_rec_t *) rec)->uid;
+}
+
+static uint32_t _user_name_key(void *rec)
+{
+	return (uint32_t) _get_str_inx(((slurmdb_user_rec_t *) rec)->name);
+}
+
+static uint32_t _qos_id_key(void *rec)
+{
+	return ((slurmdb_qos_rec_t *) rec)->id;
+}
+
+static uint32_t _qos_name_key(void *rec)
+{
+	return (uint32_t) _get_str_inx(((slurmdb_qos_rec_t *) rec)->name);
+}
+
+static uint32_t _wckey_id_key(void *rec)
+{
+	return ((slurmdb_wckey_rec_t *) rec)->id;
+}
+
+static uint32_t _wckey_user_name_key(void *rec)
+{
+	slurmdb_wckey_rec_t *wckey = rec;
+
+	return wckey->uid + (uint32_t) _get_str_inx(wckey->name);
+}
+
+static uint32_t _usage_saved_id_key(void *rec)
+{
+	return ((usage_saved_t *) rec)->assoc_id;
+}
+
+static void _free_rec_index(rec_index_t *index)
+{
+	rec_index_ent_t *ent, *next_ent;
+	int i;
+
+	for (i = 0; i < index->size; i++) {
+		for (ent = index->hash[i]; ent; ent = next_ent) {
+			next_ent = ent->next;
+			xfree(ent);
+		}
+	}
+	xfree(index->hash);
+	index->cnt = 0;
+	index->size = 0;
+}
+
+/* Append ent to the tail of the bucket its record hashes to */
+static void _link_rec_index(rec_index_t *index, rec_index_ent_t *ent)
+{
+	rec_index_ent_t **ent_pptr;
+
+	ent_pptr = &index->hash[index->key_f(ent->rec) % index->size];
+	while (*ent_pptr)
+		ent_pptr = &(*ent_pptr)->next;
+	ent->next = NULL;
+	*ent_pptr = ent;
+}
+
+static void _add_rec_index(rec_index_t *index, void *rec)
+{
+	rec_index_ent_t *ent, *next_ent, **old_hash;
+	int i, old_size;
+
+	xassert(rec);
+
+	if (!index->hash) {
+		index->size = REC_INDEX_SIZE;
+		index->hash = xmalloc(index->size * sizeof(rec_index_ent_t *));
+	} else if (index->cnt >= index->size) {
+		/*
+		 * Double the buckets. Walking each old bucket in order keeps
+		 * the order of the records sharing a new bucket.
+		 */
+		old_hash = index->hash;
+		old_size = index->size;
+		index->size *= 2;
+		index->hash = xmalloc(index->size * sizeof(rec_index_ent_t *));
+		for (i = 0; i < old_size; i++) {
+			for (ent = old_hash[i]; ent; ent = next_ent) {
+				next_ent = ent->next;
+				_link_rec_index(index, ent);
+			}
+		}
+		xfree(old_hash);
+	}
+
+	ent = xmalloc(sizeof(rec_index_ent_t));
+	ent->rec = rec;
+	_link_rec_index(index, ent);
+	index->cnt++;
+}
+
+static bool _unlink_rec_index(rec_index_t *index, rec_index_ent_t **ent_pptr,
+			      void *rec)
+{
+	rec_index_ent_t *ent;
+
+	while ((ent = *ent_pptr)) {
+		if (ent->rec == rec) {
+			*ent_pptr = ent->next;
+			xfree(ent);
+			index->cnt--;
+			return true;
+		}
+		ent_pptr = &ent->next;
+	}
+
+	return false;
+}
+
+/*
+ * Remove rec from the index. Call this before changing any field the
+ * index is keyed on, otherwise every bucket has to be searched.
+ */
+static void _delete_rec_index(rec_index_t *index, void *rec)
+{
+	int i;
+
+	if (!index->hash)
+		return;
+
+	if (_unlink_rec_index(index,
+			      &index->hash[index->key_f(rec) % index->size],
+			      rec))
+		return;
+
+	for (i = 0; i < index->size; i++) {
+		if (_unlink_rec_index(index, &index->hash[i], rec))
+			return;
+	}
+}
+
+/* Rebuild the index from scratch from the records in list */
+static void _build_rec_index(rec_index_t *index, List list)
+{
+	ListIterator itr;
+	void *rec;
+
+	_free_rec_index(index);
+	if (!list)
+		return;
+
+	index->size = MAX(list_count(list), REC_INDEX_SIZE);
+	index->hash = xmalloc(index->size * sizeof(rec_index_ent_t *));
+	itr = list_iterator_create(list);
+	while ((rec = list_next(itr)))
+		_add_rec_index(index, rec);
+	list_iterator_destroy(itr);
+}
+
+static rec_index_ent_t *_rec_index_bucket(rec_index_t *index, uint32_t key)
+{
+	if (!index->hash)
+		return NULL;
+
+	return index->hash[key % index->size];
+}
+
+/* NOTE: the user write lock must be set before calling this. */
+static void _build_user_index(void)
+{
+	_build_rec_index(&user_uid_index, assoc_mgr_user_list);
+	_build_rec_index(&user_name_index, assoc_mgr_user_list);
+}
+
+static void _add_user_index(slurmdb_user_rec_t *user)
+{
+	_add_rec_index(&user_uid_index, user);
+	_add_rec_index(&user_name_index, user);
+}
+
+static void _delete_user_index(slurmdb_user_rec_t *user)
+{
+	_delete_rec_index(&user_uid_index, user);
+	_delete_rec_index(&user_name_index, user);
+}
+
+/* NOTE: the QOS write lock must be set before calling this. */
+static void _build_qos_index(void)
+{
+	_build_rec_index(&qos_id_index, assoc_mgr_qos_list);
+	_build_rec_index(&qos_name_index, assoc_mgr_qos_list);
+}
+
+static void _add_qos_index(slurmdb_qos_rec_t *qos)
+{
+	_add_rec_index(&qos_id_index, qos);
+	_add_rec_index(&qos_name_index, qos);
+}
+
+static void _delete_qos_index(slurmdb_qos_rec_t *qos)
+{
+	_delete_rec_index(&qos_id_index, qos);
+	_delete_rec_index(&qos_name_index, qos);
+}
+
+/* NOTE: the wckey write lock must be set before calling this. */
+static void _build_wckey_index(void)
+{
+	_build_rec_index(&wckey_id_index, assoc_mgr_wckey_list);
+	_build_rec_index(&wckey_index, assoc_mgr_wckey_list);
+}
+
+static void _add_wckey_index(slurmdb_wckey_rec_t *wckey)
+{
+	_add_rec_index(&wckey_id_index, wckey);
+	_add_rec_index(&wckey_index, wckey);
+}
+
+static void _delete_wckey_index(slurmdb_wckey_rec_t *wckey)
+{
+	_delete_rec_index(&wckey_id_index, wckey);
+	_delete_rec_index(&wckey_index, wckey);
+}
+
+/*
+ * _find_user_rec - return the user record with the given uid, or with
+ * the given name if uid is NO_VAL
+ */
+static slurmdb_user_rec_t *_find_user_rec(uint32_t uid, char *name)
+{
+	rec_index_ent_t *ent;
+	slurmdb_user_rec_t *found_user;
+
+	if (uid != NO_VAL) {
+		for (ent = _rec_index_bucket(&user_uid_index, uid); ent;
+		     ent = ent->next) {
+			found_user = ent->rec;
+			if (found_user->uid == uid)
+				return found_user;
+		}
+	} else if (name) {
+		for (ent = _rec_index_bucket(&user_name_index,
+					     (uint32_t) _get_str_inx(name));
+		     ent; ent = ent->next) {
+			found_user = ent->rec;
+			if (!xstrcasecmp(name, found_user->name))
+				return found_user;
+		}
+	}
+
+	return NULL;
+}
+
+static bool _match_wckey(slurmdb_wckey_rec_t *wckey,
+			 slurmdb_wckey_rec_t *found_wckey)
+{
+	if (wckey->uid != NO_VAL) {
+		if (wckey->uid != found_wckey->uid) {
+			debug4("not the right user %u != %u",
+			       wckey->uid, found_wckey->uid);
+			return false;
+		}
+	} else if (wckey->user && xstrcasecmp(wckey->user, found_wckey->user))
+		return false;
+
+	if (wckey->name
+	    && (!found_wckey->name
+		|| xstrcasecmp(wckey->name, found_wckey->name))) {
+		debug4("not the right name %s != %s",
+		       wckey->name, found_wckey->name);
+		return false;
+	}
+
+	/* only check for on the slurmdbd */
+	if (!assoc_mgr_cluster_name) {
+		if (!wckey->cluster) {
+			error("No cluster name was given to check against, "
+			      "we need one to get a wckey.");
+			return false;
+		}
+
+		if (found_wckey->cluster
+		    && xstrcasecmp(wckey->cluster, found_wckey->cluster)) {
+			debug4("not the right cluster");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * _find_wckey_rec - return the wckey record matching the id of wckey or,
+ * without an id, its user, name and cluster. Only a lookup by user name
+ * or without a wckey name needs to walk the whole list.
+ */
+static slurmdb_wckey_rec_t *_find_wckey_rec(slurmdb_wckey_rec_t *wckey)
+{
+	rec_index_ent_t *ent;
+	ListIterator itr;
+	slurmdb_wckey_rec_t *found_wckey;
+
+	if (wckey->id) {
+		for (ent = _rec_index_bucket(&wckey_id_index, wckey->id); ent;
+		     ent = ent->next) {
+			found_wckey = ent->rec;
+			if (found_wckey->id == wckey->id)
+				return found_wckey;
+		}
+		return NULL;
+	}
+
+	if ((wckey->uid != NO_VAL) && wckey->name) {
+		for (ent = _rec_index_bucket(&wckey_index,
+					     _wckey_user_name_key(wckey));
+		     ent; ent = ent->next) {
+			found_wckey = ent->rec;
+			if (_match_wckey(wckey, found_wckey))
+				return found_wckey;
+		}
+		return NULL;
+	}
+
+	itr = list_iterator_create(assoc_mgr_wckey_list);
+	while ((found_wckey = list_next(itr))) {
+		if (_match_wckey(wckey, found_wckey))
+			break;
+	}
+	list_iterator_destroy(itr);
+
+	return found_wckey;
+}
+
+/* _find_qos_rec - return the QOS record with the given id or name */
+static slurmdb_qos_rec_t *_find_qos_rec(uint32_t id, char *name)
+{
+	rec_index_ent_t *ent;
+	slurmdb_qos_rec_t *found_qos;
+
+	for (ent = _rec_index_bucket(&qos_id_index, id); ent; ent = ent->next) {
+		found_qos = ent->rec;
+		if (found_qos->id == id)
+			return found_qos;
+	}
+
+	if (!name)
+		return NULL;
+
+	for (ent = _rec_index_bucket(&qos_name_index,
+				     (uint32_t) _get_str_inx(name));
+	     ent; ent = ent->next) {
+		found_qos = ent->rec;
+		if (!xstrcasecmp(name, found_qos->name))
+			return found_qos;
+	}
+
+	return NULL;
 }
 
 
@@ -542,9 +1034,12 @@ static int _change_user_name(slurmdb_user_rec_t *user)
 		itr = list_iterator_create(assoc_mgr_wckey_list);
 		while ((wckey = list_next(itr))) {
 			if (!xstrcmp(user->old_name, wckey->user)) {
+				/* The wckey index is keyed on the uid */
+				_delete_wckey_index(wckey);
 				xfree(wckey->user);
 				wckey->user = xstrdup(user->name);
 				wckey->uid = user->uid;
+				_add_wckey_index(wckey);
 				debug3("changing wckey %d", wckey->id);
 			}
 		}
@@ -940,8 +1435,8 @@ static int _post_assoc_list(void)
 	if (!assoc_mgr_assoc_list)
 		return SLURM_ERROR;
 
-	xfree(assoc_hash_id);
-	xfree(assoc_hash);
+	g_assoc_usage_gen++;
+	_alloc_assoc_hash(list_count(assoc_mgr_assoc_list));
 
 	itr = list_iterator_create(assoc_mgr_assoc_list);
 
@@ -1036,6 +1531,7 @@ static int _post_qos_list(List qos_list)
 
 	g_qos_count = 0;
 	g_qos_max_priority = 0;
+	g_qos_update_gen++;
 
 	while ((qos = list_next(itr))) {
 		if (qos->flags & QOS_FLAG_NOTSET)
@@ -1234,6 +1730,7 @@ extern int assoc_mgr_post_tres_list(List new_list)
 	new_list = NULL;
 
 	g_tres_count = new_cnt;
+	g_assoc_usage_gen++;
 
 	if ((changed_size || changed_pos) &&
 	    assoc_mgr_assoc_list && assoc_mgr_qos_list) {
@@ -1574,6 +2071,7 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 	new_list = NULL;
 
 	_post_qos_list(assoc_mgr_qos_list);
+	_build_qos_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1594,6 +2092,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_build_user_index();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_user_list: "
@@ -1605,6 +2104,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_build_user_index();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -1642,6 +2142,7 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 		/* create list so we don't keep calling this if there
 		   isn't anything there */
 		assoc_mgr_wckey_list = list_create(slurmdb_destroy_wckey_rec);
+		_build_wckey_index();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_WCKEYS) {
 			error("_get_assoc_mgr_wckey_list: "
@@ -1655,6 +2156,7 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 	}
 
 	_post_wckey_list(assoc_mgr_wckey_list);
+	_build_wckey_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1832,6 +2334,7 @@ static int _refresh_assoc_mgr_qos_list(void *db_conn, int enforce)
 	}
 
 	assoc_mgr_qos_list = current_qos;
+	_build_qos_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1865,6 +2368,7 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 	FREE_NULL_LIST(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
+	_build_user_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1907,6 +2411,7 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 	FREE_NULL_LIST(assoc_mgr_wckey_list);
 
 	assoc_mgr_wckey_list = current_wckeys;
+	_build_wckey_index();
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -2045,6 +2550,9 @@ extern int assoc_mgr_fini(bool save_state)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_build_user_index();
+	_build_qos_index();
+	_build_wckey_index();
 
 	assoc_mgr_root_assoc = NULL;
 
@@ -2053,6 +2561,11 @@ extern int assoc_mgr_fini(bool save_state)
 
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
+	assoc_hash_cnt = 0;
+
+	_free_usage_saved();
+	xfree(usage_decay);
+	usage_decay_cnt = 0;
 
 	assoc_mgr_unlock(&locks);
 
@@ -2547,7 +3060,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  slurmdb_user_rec_t **user_pptr,
 				  bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { .user = READ_LOCK };
 
@@ -2569,16 +3081,7 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !xstrcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_user = _find_user_rec(user->uid, user->name);
 
 	if (!found_user) {
 		if (!locked)
@@ -2623,7 +3126,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr, bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { .qos = READ_LOCK };
 
@@ -2658,14 +3160,7 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !xstrcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_qos = _find_qos_rec(qos->id, qos->name);
 
 	if (!found_qos) {
 		if (!locked)
@@ -2771,8 +3266,6 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 				   slurmdb_wckey_rec_t **wckey_pptr,
 				   bool locked)
 {
-	ListIterator itr = NULL;
-	slurmdb_wckey_rec_t * found_wckey = NULL;
 	slurmdb_wckey_rec_t * ret_wckey = NULL;
 	assoc_mgr_lock_t locks = { .wckey = READ_LOCK };
 
@@ -2856,55 +3349,7 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 
 	xassert(verify_assoc_lock(WCKEY_LOCK, READ_LOCK));
 
-	itr = list_iterator_create(assoc_mgr_wckey_list);
-	while ((found_wckey = list_next(itr))) {
-		if (wckey->id) {
-			if (wckey->id == found_wckey->id) {
-				ret_wckey = found_wckey;
-				break;
-			}
-			continue;
-		} else {
-			if (wckey->uid != NO_VAL) {
-				if (wckey->uid != found_wckey->uid) {
-					debug4("not the right user %u != %u",
-					       wckey->uid, found_wckey->uid);
-					continue;
-				}
-			} else if (wckey->user &&
-				   xstrcasecmp(wckey->user, found_wckey->user))
-				continue;
-
-			if (wckey->name
-			    && (!found_wckey->name
-				|| xstrcasecmp(wckey->name,
-					       found_wckey->name))) {
-				debug4("not the right name %s != %s",
-				       wckey->name, found_wckey->name);
-				continue;
-			}
-
-			/* only check for on the slurmdbd */
-			if (!assoc_mgr_cluster_name) {
-				if (!wckey->cluster) {
-					error("No cluster name was given "
-					      "to check against, "
-					      "we need one to get a wckey.");
-					continue;
-				}
-
-				if (found_wckey->cluster
-				    && xstrcasecmp(wckey->cluster,
-						   found_wckey->cluster)) {
-					debug4("not the right cluster");
-					continue;
-				}
-			}
-		}
-		ret_wckey = found_wckey;
-		break;
-	}
-	list_iterator_destroy(itr);
+	ret_wckey = _find_wckey_rec(wckey);
 
 	if (!ret_wckey) {
 		if (!locked)
@@ -4022,6 +4467,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 		slurmdb_sort_hierarchical_assoc_list(
 			assoc_mgr_assoc_list, true);
 
+	g_assoc_usage_gen++;
+
 	if (!locked)
 		assoc_mgr_unlock(&locks);
 
@@ -4149,6 +4596,7 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 			else
 				object->is_def = 0;
 			list_append(assoc_mgr_wckey_list, object);
+			_add_wckey_index(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_WCKEY:
@@ -4156,6 +4604,7 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 				//rc = SLURM_ERROR;
 				break;
 			}
+			_delete_wckey_index(rec);
 			list_delete_item(itr);
 			break;
 		default:
@@ -4218,11 +4667,13 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 					      rec->name);
 					break;
 				}
+				_delete_user_index(rec);
 				xfree(rec->old_name);
 				rec->old_name = rec->name;
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				_add_user_index(rec);
 			}
 
 			if (object->default_acct) {
@@ -4253,6 +4704,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_add_user_index(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_USER:
@@ -4260,6 +4712,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 				//rc = SLURM_ERROR;
 				break;
 			}
+			_delete_user_index(rec);
 			list_delete_item(itr);
 			break;
 		case SLURMDB_ADD_COORD:
@@ -4340,6 +4793,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			assoc_mgr_set_qos_tres_cnt(object);
 
 			list_append(assoc_mgr_qos_list, object);
+			_add_qos_index(object);
 /* 			char *tmp = get_qos_complete_str_bitstr( */
 /* 				assoc_mgr_qos_list, */
 /* 				object->preempt_bitstr); */
@@ -4620,6 +5074,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			if (rec->priority == g_qos_max_priority)
 				redo_priority = 2;
 
+			_delete_qos_index(rec);
 			if (init_setup.remove_qos_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
@@ -4703,6 +5158,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 		_post_qos_list(assoc_mgr_qos_list);
 
 	list_iterator_destroy(itr);
+	g_qos_update_gen++;
 
 	if (!locked)
 		assoc_mgr_unlock(&locks);
@@ -5007,6 +5463,7 @@ extern void assoc_mgr_clear_used_info(void)
 		list_iterator_destroy(itr);
 	}
 
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 }
 
@@ -5116,6 +5573,8 @@ extern void assoc_mgr_remove_assoc_usage(slurmdb_assoc_rec_t *assoc)
 	xassert(assoc);
 	xassert(assoc->usage);
 
+	g_assoc_usage_gen++;
+
 	if (assoc->user) {
 		child = "user";
 		child_str = assoc->user;
@@ -5178,29 +5637,459 @@ extern void assoc_mgr_remove_qos_usage(slurmdb_qos_rec_t *qos)
 	}
 }
 
-extern int dump_assoc_mgr_state(void)
+/* Write buffer to the state save file name, keeping the prior copy in
+ * name.old */
+static int _write_state_file(Buf buffer, char *name, int *high_buffer_size)
 {
-	static int high_buffer_size = (1024 * 1024);
 	int error_code = 0, log_fd;
-	char *old_file = NULL, *new_file = NULL, *reg_file = NULL,
-		*tmp_char = NULL;
-	dbd_list_msg_t msg;
-	Buf buffer = NULL;
-	assoc_mgr_lock_t locks = { .assoc = READ_LOCK, .file = WRITE_LOCK,
-				   .qos = READ_LOCK, .res = READ_LOCK,
-				   .tres = READ_LOCK, .user = READ_LOCK,
-				   .wckey = READ_LOCK};
-	DEF_TIMERS;
-
-	xassert(init_setup.state_save_location &&
-		*init_setup.state_save_location);
-
-	START_TIMER;
+	char *old_file, *new_file, *reg_file;
 
-	/* now make a file for last_tres */
-	buffer = init_buf(high_buffer_size);
+	reg_file = xstrdup_printf("%s/%s",
+				  *init_setup.state_save_location, name);
+	old_file = xstrdup_printf("%s.old", reg_file);
+	new_file = xstrdup_printf("%s.new", reg_file);
 
-	/* write header: version, time */
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		int pos = 0, nwrite = get_buf_offset(buffer), amount;
+		char *data = (char *)get_buf_data(buffer);
+		*high_buffer_size = MAX(nwrite, *high_buffer_size);
+		while (nwrite > 0) {
+			amount = write(log_fd, &data[pos], nwrite);
+			if ((amount < 0) && (errno != EINTR)) {
+				error("Error writing file %s, %m", new_file);
+				error_code = errno;
+				break;
+			}
+			nwrite -= amount;
+			pos    += amount;
+		}
+		fsync(log_fd);
+		close(log_fd);
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else {			/* file shuffle */
+		(void) unlink(old_file);
+		if (link(reg_file, old_file))
+			debug4("unable to create link for %s -> %s: %m",
+			       reg_file, old_file);
+		(void) unlink(reg_file);
+		if (link(new_file, reg_file))
+			debug4("unable to create link for %s -> %s: %m",
+			       new_file, reg_file);
+		(void) unlink(new_file);
+	}
+	xfree(old_file);
+	xfree(reg_file);
+	xfree(new_file);
+
+	return error_code;
+}
+
+/* Append buffer to the end of the state save file name */
+static int _append_state_file(Buf buffer, char *name)
+{
+	int error_code = 0, log_fd;
+	int pos = 0, nwrite = get_buf_offset(buffer), amount;
+	char *data = (char *)get_buf_data(buffer);
+	char *reg_file;
+
+	reg_file = xstrdup_printf("%s/%s",
+				  *init_setup.state_save_location, name);
+
+	log_fd = open(reg_file, O_WRONLY | O_APPEND);
+	if (log_fd < 0) {
+		error_code = errno;
+		error("Can't save state, open file %s error %m", reg_file);
+		xfree(reg_file);
+		return error_code;
+	}
+	while (nwrite > 0) {
+		amount = write(log_fd, &data[pos], nwrite);
+		if ((amount < 0) && (errno != EINTR)) {
+			error("Error writing file %s, %m", reg_file);
+			error_code = errno;
+			break;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+	fsync(log_fd);
+	close(log_fd);
+	xfree(reg_file);
+
+	return error_code;
+}
+
+static usage_saved_t *_find_usage_saved(uint32_t assoc_id)
+{
+	rec_index_ent_t *ent;
+
+	for (ent = _rec_index_bucket(&usage_saved_index, assoc_id); ent;
+	     ent = ent->next) {
+		if (((usage_saved_t *) ent->rec)->assoc_id == assoc_id)
+			return ent->rec;
+	}
+
+	return NULL;
+}
+
+static void _free_usage_saved(void)
+{
+	rec_index_ent_t *ent;
+	usage_saved_t *saved;
+	int i;
+
+	for (i = 0; i < usage_saved_index.size; i++) {
+		for (ent = usage_saved_index.hash[i]; ent; ent = ent->next) {
+			saved = ent->rec;
+			xfree(saved->usage_tres_raw);
+			xfree(saved);
+		}
+	}
+	_free_rec_index(&usage_saved_index);
+}
+
+/* Has the usage of assoc changed, other than by decay, since it was last
+ * written to the assoc_usage state? */
+static bool _assoc_usage_changed(slurmdb_assoc_rec_t *assoc)
+{
+	slurmdb_assoc_usage_t *usage = assoc->usage;
+	usage_saved_t *saved;
+	int i;
+
+	if (!(saved = _find_usage_saved(assoc->id)) ||
+	    (saved->tres_cnt != g_tres_count) ||
+	    (saved->usage_raw != usage->usage_raw) ||
+	    (saved->grp_used_wall != usage->grp_used_wall))
+		return true;
+
+	for (i = 0; i < g_tres_count; i++) {
+		if (saved->usage_tres_raw[i] != usage->usage_tres_raw[i])
+			return true;
+	}
+
+	return false;
+}
+
+/* Multiply the usage of every association by factor */
+static void _decay_assoc_usage(double factor)
+{
+	ListIterator itr;
+	slurmdb_assoc_rec_t *assoc;
+	int i;
+
+	itr = list_iterator_create(assoc_mgr_assoc_list);
+	while ((assoc = list_next(itr))) {
+		assoc->usage->usage_raw *= factor;
+		for (i = 0; i < g_tres_count; i++)
+			assoc->usage->usage_tres_raw[i] *= factor;
+		assoc->usage->grp_used_wall *= factor;
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Pack the usage of assoc and note it as saved.
+ * file write lock and assoc, tres read locks need to be locked before
+ * calling this. */
+static void _pack_assoc_usage(slurmdb_assoc_rec_t *assoc, Buf buffer)
+{
+	slurmdb_assoc_usage_t *usage = assoc->usage;
+	usage_saved_t *saved;
+	char *tmp_char;
+
+	pack32(assoc->id, buffer);
+	packlongdouble(usage->usage_raw, buffer);
+	tmp_char = _make_usage_tres_raw_str(usage->usage_tres_raw);
+	packstr(tmp_char, buffer);
+	xfree(tmp_char);
+	pack32(usage->grp_used_wall, buffer);
+
+	if (!(saved = _find_usage_saved(assoc->id))) {
+		saved = xmalloc(sizeof(usage_saved_t));
+		saved->assoc_id = assoc->id;
+		_add_rec_index(&usage_saved_index, saved);
+	}
+	if (saved->tres_cnt != g_tres_count) {
+		xrealloc(saved->usage_tres_raw,
+			 sizeof(long double) * g_tres_count);
+		saved->tres_cnt = g_tres_count;
+	}
+	saved->grp_used_wall = usage->grp_used_wall;
+	saved->usage_raw = usage->usage_raw;
+	memcpy(saved->usage_tres_raw, usage->usage_tres_raw,
+	       sizeof(long double) * g_tres_count);
+}
+
+/*
+ * Save the usage of user associations. The decays of all usage and the
+ * associations whose usage changed otherwise since the last save are
+ * appended to assoc_usage_journal. Once the journal holds more records
+ * than there are associations (or on the first save) a new assoc_usage
+ * snapshot and an empty journal are written.
+ * file write lock and assoc, tres read locks need to be locked before
+ * calling this.
+ */
+static int _dump_assoc_usage(int *high_buffer_size)
+{
+	ListIterator itr = NULL;
+	slurmdb_assoc_rec_t *assoc = NULL;
+	int assoc_cnt = 0, changed_cnt = 0, error_code, i;
+	time_t now;
+	Buf buffer;
+
+	if (usage_journal_valid && assoc_mgr_assoc_list) {
+		itr = list_iterator_create(assoc_mgr_assoc_list);
+		while ((assoc = list_next(itr))) {
+			if (!assoc->user)
+				continue;
+			assoc_cnt++;
+			if (_assoc_usage_changed(assoc))
+				changed_cnt++;
+		}
+		list_iterator_destroy(itr);
+	}
+
+	if (usage_journal_valid &&
+	    ((usage_journal_recs + usage_decay_cnt + changed_cnt) <=
+	     assoc_cnt)) {
+		if (!changed_cnt && !usage_decay_cnt)
+			return SLURM_SUCCESS;
+
+		buffer = init_buf(BUF_SIZE);
+		/* Decays come first, they applied to the saved usage */
+		for (i = 0; i < usage_decay_cnt; i++) {
+			pack16(USAGE_JOURNAL_DECAY, buffer);
+			pack_time(usage_decay[i].decay_time, buffer);
+			packdouble(usage_decay[i].factor, buffer);
+		}
+		itr = list_iterator_create(assoc_mgr_assoc_list);
+		while ((assoc = list_next(itr))) {
+			if (!assoc->user || !_assoc_usage_changed(assoc))
+				continue;
+			pack16(USAGE_JOURNAL_ASSOC, buffer);
+			_pack_assoc_usage(assoc, buffer);
+		}
+		list_iterator_destroy(itr);
+
+		error_code = _append_state_file(buffer,
+						"assoc_usage_journal");
+		free_buf(buffer);
+		if (error_code == SLURM_SUCCESS) {
+			usage_journal_recs += usage_decay_cnt + changed_cnt;
+			debug2("%s: journaled %d decays and usage of %d of %d associations",
+			       __func__, usage_decay_cnt, changed_cnt,
+			       assoc_cnt);
+			xfree(usage_decay);
+			usage_decay_cnt = 0;
+			return SLURM_SUCCESS;
+		}
+		/* Fall back to writing everything */
+	}
+
+	/* The snapshot time identifies the journal that follows it */
+	now = MAX(time(NULL), usage_snapshot_time + 1);
+	usage_journal_valid = false;
+	usage_journal_recs = 0;
+	xfree(usage_decay);
+	usage_decay_cnt = 0;
+	_free_usage_saved();
+
+	buffer = init_buf(*high_buffer_size);
+	/* write header: version, time */
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(now, buffer);
+
+	if (assoc_mgr_assoc_list) {
+		itr = list_iterator_create(assoc_mgr_assoc_list);
+		while ((assoc = list_next(itr))) {
+			if (assoc->user)
+				_pack_assoc_usage(assoc, buffer);
+		}
+		list_iterator_destroy(itr);
+	}
+
+	error_code = _write_state_file(buffer, "assoc_usage",
+				       high_buffer_size);
+	free_buf(buffer);
+	if (error_code)
+		return error_code;
+	usage_snapshot_time = now;
+
+	/* now start an empty journal following this snapshot */
+	buffer = init_buf(BUF_SIZE);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(now, buffer);
+	error_code = _write_state_file(buffer, "assoc_usage_journal",
+				       high_buffer_size);
+	free_buf(buffer);
+	if (error_code == SLURM_SUCCESS)
+		usage_journal_valid = true;
+
+	return error_code;
+}
+
+/*
+ * Replay the assoc_usage_journal following the assoc_usage snapshot taken
+ * at snapshot_time. A decay record multiplies the usage of every
+ * association by its factor. Any other record holds the usage of one user
+ * association; the change from its current usage is applied to it and to
+ * each of its parents.
+ * assoc write lock and file write lock need to be locked before calling
+ * this.
+ */
+static void _load_assoc_usage_journal(time_t snapshot_time)
+{
+	int i, rec_cnt = 0;
+	uint16_t rec_type, ver = 0;
+	char *state_file, *tmp_str = NULL;
+	Buf buffer = NULL;
+	time_t buf_time = 0, decay_time;
+	double factor;
+
+	state_file = xstrdup_printf("%s/assoc_usage_journal",
+				    *init_setup.state_save_location);
+	if (!(buffer = create_mmap_buf(state_file))) {
+		debug2("No Assoc usage journal (%s) to recover", state_file);
+		xfree(state_file);
+		return;
+	}
+	xfree(state_file);
+
+	safe_unpack16(&ver, buffer);
+	safe_unpack_time(&buf_time, buffer);
+	if ((ver > SLURM_PROTOCOL_VERSION) ||
+	    (ver < SLURM_MIN_PROTOCOL_VERSION) ||
+	    (buf_time != snapshot_time)) {
+		debug("Assoc usage journal does not follow the assoc_usage snapshot, ignoring it");
+		free_buf(buffer);
+		return;
+	}
+
+	while (remaining_buf(buffer) > 0) {
+		uint32_t assoc_id = 0;
+		uint32_t grp_used_wall = 0;
+		long double usage_raw = 0;
+		slurmdb_assoc_rec_t *assoc = NULL;
+		uint32_t tmp32;
+		double used_wall_diff;
+		long double usage_raw_diff;
+		long double usage_tres_raw[g_tres_count];
+
+		safe_unpack16(&rec_type, buffer);
+		if (rec_type == USAGE_JOURNAL_DECAY) {
+			safe_unpack_time(&decay_time, buffer);
+			safe_unpackdouble(&factor, buffer);
+			rec_cnt++;
+			debug3("Assoc usage journal: usage decayed by %f at %ld",
+			       factor, (long) decay_time);
+			_decay_assoc_usage(factor);
+			continue;
+		} else if (rec_type != USAGE_JOURNAL_ASSOC) {
+			error("Assoc usage journal record type %hu unknown, recovered %d records",
+			      rec_type, rec_cnt);
+			free_buf(buffer);
+			return;
+		}
+
+		safe_unpack32(&assoc_id, buffer);
+		safe_unpacklongdouble(&usage_raw, buffer);
+		safe_unpackstr_xmalloc(&tmp_str, &tmp32, buffer);
+		safe_unpack32(&grp_used_wall, buffer);
+		rec_cnt++;
+
+		if (!(assoc = _find_assoc_rec_id(assoc_id))) {
+			xfree(tmp_str);
+			continue;
+		}
+
+		memset(usage_tres_raw, 0, sizeof(usage_tres_raw));
+		_set_usage_tres_raw(usage_tres_raw, tmp_str);
+		xfree(tmp_str);
+
+		used_wall_diff = grp_used_wall - assoc->usage->grp_used_wall;
+		usage_raw_diff = usage_raw - assoc->usage->usage_raw;
+		for (i = 0; i < g_tres_count; i++)
+			usage_tres_raw[i] -= assoc->usage->usage_tres_raw[i];
+
+		while (assoc) {
+			assoc->usage->grp_used_wall += used_wall_diff;
+			assoc->usage->usage_raw += usage_raw_diff;
+			for (i = 0; i < g_tres_count; i++)
+				assoc->usage->usage_tres_raw[i] +=
+					usage_tres_raw[i];
+			assoc = assoc->usage->parent_assoc_ptr;
+		}
+	}
+	debug2("Recovered %d records from Assoc usage journal", rec_cnt);
+	free_buf(buffer);
+	return;
+
+unpack_error:
+	/* A save interrupted mid-record leaves a partial record at the end */
+	error("Incomplete assoc usage journal, recovered %d records",
+	      rec_cnt);
+	xfree(tmp_str);
+	free_buf(buffer);
+}
+
+extern void assoc_mgr_usage_decayed(double factor)
+{
+	rec_index_ent_t *ent;
+	usage_saved_t *saved;
+	int i, j;
+
+	xassert(verify_assoc_lock(ASSOC_LOCK, WRITE_LOCK));
+
+	/* The next save writes a new snapshot */
+	if (!usage_journal_valid)
+		return;
+
+	/* Decay the saved usage exactly as the usage itself was decayed */
+	for (i = 0; i < usage_saved_index.size; i++) {
+		for (ent = usage_saved_index.hash[i]; ent; ent = ent->next) {
+			saved = ent->rec;
+			saved->usage_raw *= factor;
+			for (j = 0; j < saved->tres_cnt; j++)
+				saved->usage_tres_raw[j] *= factor;
+			saved->grp_used_wall *= factor;
+		}
+	}
+
+	xrealloc(usage_decay, sizeof(usage_decay_t) * (usage_decay_cnt + 1));
+	usage_decay[usage_decay_cnt].decay_time = time(NULL);
+	usage_decay[usage_decay_cnt].factor = factor;
+	usage_decay_cnt++;
+}
+
+extern int dump_assoc_mgr_state(void)
+{
+	static int high_buffer_size = (1024 * 1024);
+	int error_code = 0, log_fd, rc;
+	char *old_file = NULL, *new_file = NULL, *reg_file = NULL,
+		*tmp_char = NULL;
+	dbd_list_msg_t msg;
+	Buf buffer = NULL;
+	assoc_mgr_lock_t locks = { .assoc = READ_LOCK, .file = WRITE_LOCK,
+				   .qos = READ_LOCK, .res = READ_LOCK,
+				   .tres = READ_LOCK, .user = READ_LOCK,
+				   .wckey = READ_LOCK};
+	DEF_TIMERS;
+
+	xassert(init_setup.state_save_location &&
+		*init_setup.state_save_location);
+
+	START_TIMER;
+
+	/* now make a file for last_tres */
+	buffer = init_buf(high_buffer_size);
+
+	/* write header: version, time */
 	pack16(SLURM_PROTOCOL_VERSION, buffer);
 	pack_time(time(NULL), buffer);
 
@@ -5358,76 +6247,9 @@ extern int dump_assoc_mgr_state(void)
 
 	free_buf(buffer);
 	/* now make a file for assoc_usage */
+	if ((rc = _dump_assoc_usage(&high_buffer_size)))
+		error_code = rc;
 
-	buffer = init_buf(high_buffer_size);
-	/* write header: version, time */
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-
-	if (assoc_mgr_assoc_list) {
-		ListIterator itr = NULL;
-		slurmdb_assoc_rec_t *assoc = NULL;
-		itr = list_iterator_create(assoc_mgr_assoc_list);
-		while ((assoc = list_next(itr))) {
-			if (!assoc->user)
-				continue;
-
-			pack32(assoc->id, buffer);
-			packlongdouble(assoc->usage->usage_raw, buffer);
-			tmp_char = _make_usage_tres_raw_str(
-				assoc->usage->usage_tres_raw);
-			packstr(tmp_char, buffer);
-			xfree(tmp_char);
-			pack32(assoc->usage->grp_used_wall, buffer);
-		}
-		list_iterator_destroy(itr);
-	}
-
-	reg_file = xstrdup_printf("%s/assoc_usage",
-				  *init_setup.state_save_location);
-	old_file = xstrdup_printf("%s.old", reg_file);
-	new_file = xstrdup_printf("%s.new", reg_file);
-
-	log_fd = creat(new_file, 0600);
-	if (log_fd < 0) {
-		error("Can't save state, create file %s error %m",
-		      new_file);
-		error_code = errno;
-	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-		fsync(log_fd);
-		close(log_fd);
-	}
-	if (error_code)
-		(void) unlink(new_file);
-	else {			/* file shuffle */
-		(void) unlink(old_file);
-		if (link(reg_file, old_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       reg_file, old_file);
-		(void) unlink(reg_file);
-		if (link(new_file, reg_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       new_file, reg_file);
-		(void) unlink(new_file);
-	}
-	xfree(old_file);
-	xfree(reg_file);
-	xfree(new_file);
-
-	free_buf(buffer);
 	/* now make a file for qos_usage */
 
 	buffer = init_buf(high_buffer_size);
@@ -5509,7 +6331,7 @@ extern int load_assoc_usage(void)
 	char *state_file, *tmp_str = NULL;
 	Buf buffer = NULL;
 	time_t buf_time;
-	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .file = READ_LOCK };
+	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .file = WRITE_LOCK };
 
 	if (!assoc_mgr_assoc_list)
 		return SLURM_SUCCESS;
@@ -5522,6 +6344,7 @@ extern int load_assoc_usage(void)
 	xstrcat(state_file, "/assoc_usage");	/* Always ignore .old file */
 	//info("looking at the %s file", state_file);
 	assoc_mgr_lock(&locks);
+	g_assoc_usage_gen++;
 
 	if (!(buffer = create_mmap_buf(state_file))) {
 		debug2("No Assoc usage file (%s) to recover", state_file);
@@ -5589,6 +6412,8 @@ extern int load_assoc_usage(void)
 
 		xfree(tmp_str);
 	}
+	usage_snapshot_time = buf_time;
+	_load_assoc_usage_journal(buf_time);
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -5880,6 +6705,7 @@ extern int load_assoc_mgr_state(bool only_tres)
 			FREE_NULL_LIST(assoc_mgr_user_list);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_build_user_index();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -5919,6 +6745,7 @@ extern int load_assoc_mgr_state(bool only_tres)
 			FREE_NULL_LIST(assoc_mgr_qos_list);
 			assoc_mgr_qos_list = msg->my_list;
 			_post_qos_list(assoc_mgr_qos_list);
+			_build_qos_index();
 			debug("Recovered %u qos",
 			      list_count(assoc_mgr_qos_list));
 			msg->my_list = NULL;
@@ -5935,6 +6762,7 @@ extern int load_assoc_mgr_state(bool only_tres)
 			}
 			FREE_NULL_LIST(assoc_mgr_wckey_list);
 			assoc_mgr_wckey_list = msg->my_list;
+			_build_wckey_index();
 			debug("Recovered %u wckeys",
 			      list_count(assoc_mgr_wckey_list));
 			msg->my_list = NULL;
@@ -6060,8 +6888,11 @@ extern int assoc_mgr_set_missing_uids()
 					debug2("refresh wckey "
 					       "couldn't get a uid for user %s",
 					       object->user);
-				} else
+				} else {
+					_delete_wckey_index(object);
 					object->uid = pw_uid;
+					_add_wckey_index(object);
+				}
 			}
 		}
 		list_iterator_destroy(itr);
@@ -6077,8 +6908,11 @@ extern int assoc_mgr_set_missing_uids()
 					debug3("refresh user couldn't get "
 					       "a uid for user %s",
 					       object->name);
-				} else
+				} else {
+					_delete_user_index(object);
 					object->uid = pw_uid;
+					_add_user_index(object);
+				}
 			}
 		}
 		list_iterator_destroy(itr);
@@ -117,6 +117,12 @@ extern uint32_t g_user_assoc_count; /* Number of associations which are users */
 extern uint32_t g_tres_count; /* Number of TRES from the database
 			       * which also is the number of elements
 			       * in the assoc_mgr_tres_array */
+extern uint32_t g_assoc_usage_gen; /* Changed whenever association limits,
+				    * usage or hierarchy change, only
+				    * modified under the assoc write lock */
+extern uint32_t g_qos_update_gen; /* Changed whenever QOS records are
+				   * loaded or updated, only modified
+				   * under the qos write lock */
 
 extern int assoc_mgr_init(void *db_conn, assoc_init_args_t *args,
 			  int db_conn_errno);
@@ -399,6 +405,14 @@ extern void assoc_mgr_remove_assoc_usage(slurmdb_assoc_rec_t *assoc);
  */
 extern void assoc_mgr_remove_qos_usage(slurmdb_qos_rec_t *qos);
 
+/*
+ * Note that the usage of every association was multiplied by factor, a
+ * factor of 0 meaning the usage was reset, so that the next state save
+ * journals one decay record rather than the usage of every association.
+ * NOTE: the assoc write lock must be set before calling this.
+ */
+extern void assoc_mgr_usage_decayed(double factor);
+
 /*
  * Dump the state information of the association mgr just in case the
  * database isn't up next time we run.
@@ -7931,6 +7931,29 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data, int node_cnt,
 		} else {
 			node_gres_ptr->gres_cnt_alloc += gres_cnt;
 		}
+	} else if (node_gres_ptr->gres_bit_alloc &&
+		   ((core_bitmap == NULL) || (node_gres_ptr->topo_cnt == 0)) &&
+		   (bit_size(node_gres_ptr->gres_bit_alloc) ==
+		    node_gres_ptr->gres_cnt_avail)) {
+		/*
+		 * No core topology to honor, so any free GRES will do.
+		 * Pick them a word at a time rather than testing each bit.
+		 */
+		bitstr_t *avail_gres_bitmap;
+		avail_gres_bitmap = bit_copy(node_gres_ptr->gres_bit_alloc);
+		bit_not(avail_gres_bitmap);
+		job_gres_ptr->gres_bit_alloc[node_offset] =
+			bit_pick_cnt(avail_gres_bitmap, gres_cnt);
+		if (!job_gres_ptr->gres_bit_alloc[node_offset]) {
+			/* Insufficient GRES, give job what's available */
+			job_gres_ptr->gres_bit_alloc[node_offset] =
+				avail_gres_bitmap;
+		} else
+			FREE_NULL_BITMAP(avail_gres_bitmap);
+		bit_or(node_gres_ptr->gres_bit_alloc,
+		       job_gres_ptr->gres_bit_alloc[node_offset]);
+		node_gres_ptr->gres_cnt_alloc += bit_set_count(
+				job_gres_ptr->gres_bit_alloc[node_offset]);
 	} else if (node_gres_ptr->gres_bit_alloc) {
 		job_gres_ptr->gres_bit_alloc[node_offset] =
 				bit_alloc(node_gres_ptr->gres_cnt_avail);
@@ -8032,6 +8055,8 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data, int node_cnt,
 		} else {
 			len = MIN(len, node_gres_ptr->gres_cnt_config);
 		}
+		if (node_gres_ptr->topo_cnt == 0)
+			len = 0;	/* No topology to account for */
 		for (i = 0; i < len; i++) {
 			gres_cnt = 0;
 			if (!bit_test(job_gres_ptr->
@@ -8224,6 +8249,13 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 			       i);
 			len = MIN(len, i);
 			/* proceed with request, make best effort */
+		} else {
+			/* Release the job's GRES a word at a time */
+			gres_cnt = bit_set_count(job_gres_ptr->
+						 gres_bit_alloc[node_offset]);
+			bit_and_not(node_gres_ptr->gres_bit_alloc,
+				    job_gres_ptr->gres_bit_alloc[node_offset]);
+			len = 0;
 		}
 		for (i = 0; i < len; i++) {
 			if (!bit_test(job_gres_ptr->gres_bit_alloc[node_offset],
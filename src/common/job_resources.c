@@ -422,6 +422,7 @@ extern void free_job_resources(job_resources_t **job_resrcs_pptr)
 		xfree(job_resrcs_ptr->nodes);
 		xfree(job_resrcs_ptr->sock_core_rep_count);
 		xfree(job_resrcs_ptr->sockets_per_node);
+		xfree(job_resrcs_ptr->steps_per_node);
 		xfree(job_resrcs_ptr->tasks_per_node);
 		xfree(job_resrcs_ptr);
 		*job_resrcs_pptr = NULL;
@@ -1352,6 +1353,8 @@ extern int extract_job_resources_node(job_resources_t *job, uint32_t node_id)
 		job->memory_allocated[i] = job->memory_allocated[i+1];
 		job->memory_used[i] = job->memory_used[i+1];
 	}
+	/* Steps may still reference the node, rebuild counts on demand */
+	xfree(job->steps_per_node);
 
 	xfree(job->nodes);
 	job->nodes = bitmap2node_name(job->node_bitmap);
@@ -81,6 +81,10 @@
  * sockets_per_node	- Count of sockets on this node, build by
  *			  build_job_resources() and ensures consistent
  *			  interpretation of core_bitmap
+ * steps_per_node	- For a job, count of active job steps per node. Built
+ *			  on demand by slurmctld's step_mgr.c and discarded
+ *			  whenever the step node bitmaps are rebuilt. No need
+ *			  to save/restore or pack.
  * tasks_per_node	- Expected tasks to launch per node. Currently used only
  *			  by cons_tres for tres_per_task support at resource
  *			  allocation time. No need to save/restore or pack.
@@ -121,6 +125,7 @@ struct job_resources {
 	uint32_t  ncpus;
 	uint32_t *sock_core_rep_count;
 	uint16_t *sockets_per_node;
+	uint32_t *steps_per_node;
 	uint16_t *tasks_per_node;
 	uint8_t   whole_node;
 };
@@ -99,6 +99,8 @@ int parse_select_type_param(char *select_type_parameters, uint16_t *param)
 			*param |= CR_CORE_DEFAULT_DIST_BLOCK;
 		} else if (!xstrcasecmp(str_parameters, "CR_LLN")) {
 			*param |= CR_LLN;
+		} else if (!xstrcasecmp(str_parameters, "CR_BEST_FIT")) {
+			*param |= CR_BEST_FIT;
 		} else if (!xstrcasecmp(str_parameters, "NHC_Absolutely_No")) {
 			*param |= CR_NHC_ABSOLUTELY_NO;
 			*param |= CR_NHC_STEP_NO;
@@ -197,6 +199,11 @@ extern char *select_type_param_string(uint16_t select_type_param)
 			strcat(select_str, ",");
 		strcat(select_str, "CR_LLN");
 	}
+	if (select_type_param & CR_BEST_FIT) {
+		if (select_str[0])
+			strcat(select_str, ",");
+		strcat(select_str, "CR_BEST_FIT");
+	}
 	if (select_type_param & CR_PACK_NODES) {
 		if (select_str[0])
 			strcat(select_str, ",");
@@ -0,0 +1,107 @@
+/*****************************************************************************\
+ *  tres_vec.h - Arithmetic on arrays of TRES counts
+ *****************************************************************************
+ *  Copyright (C) 2026 agent <agent@local>
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _TRES_VEC_H_
+#define _TRES_VEC_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "slurm/slurm.h"
+
+/*
+ * TRES counts are kept in arrays of g_tres_count (slurmctld_tres_cnt)
+ * elements. These helpers work on a whole array at once with no branches
+ * in the loop bodies, so the compiler can vectorize them. Callers that
+ * must skip an element (e.g. TRES_ARRAY_ENERGY) zero it in the source
+ * array instead.
+ */
+
+/* Room left under limit given used, plus one so that 0 means over the
+ * limit. INFINITE64 if there is no limit. */
+static inline uint64_t tres_avail(uint64_t limit, uint64_t used)
+{
+	if (limit == INFINITE64)
+		return INFINITE64;
+	if (used > limit)
+		return 0;
+	return limit - used + 1;
+}
+
+/* dst[i] += src[i] */
+static inline void tres_vec_add(uint64_t *dst, uint64_t *src, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		dst[i] += src[i];
+}
+
+/* dst[i] -= src[i], call tres_vec_le(src, dst) first to avoid underflow */
+static inline void tres_vec_sub(uint64_t *dst, uint64_t *src, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		dst[i] -= src[i];
+}
+
+/* RET true if a[i] <= b[i] for every i */
+static inline bool tres_vec_le(uint64_t *a, uint64_t *b, int cnt)
+{
+	uint64_t over = 0;
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		over |= (a[i] > b[i]);
+
+	return !over;
+}
+
+/* avail[i] = MIN(avail[i], tres_avail(limit[i], used[i])) */
+static inline void tres_vec_min_avail(uint64_t *avail, uint64_t *limit,
+				      uint64_t *used, int cnt)
+{
+	uint64_t room;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		room = (used[i] > limit[i]) ? 0 : (limit[i] - used[i] + 1);
+		room = (limit[i] == INFINITE64) ? INFINITE64 : room;
+		avail[i] = (room < avail[i]) ? room : avail[i];
+	}
+}
+
+#endif
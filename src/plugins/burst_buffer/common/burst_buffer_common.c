@@ -1313,7 +1313,7 @@ extern void bb_limit_rem(uint32_t user_id, uint64_t bb_size, char *pool,
  * job_ptr IN - Point to job that created, could be NULL at startup
  * bb_alloc IN - Pointer to persistent burst buffer state info
  * state_ptr IN - Pointer to burst_buffer plugin state info
- * NOTE: assoc_mgr association and qos read lock should be set before this.
+ * NOTE: assoc_mgr association and qos write lock should be set before this.
  */
 extern int bb_post_persist_create(struct job_record *job_ptr,
 				  bb_alloc_t *bb_alloc, bb_state_t *state_ptr)
@@ -1371,6 +1371,8 @@ extern int bb_post_persist_create(struct job_record *job_ptr,
 			assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 		}
 
+		g_assoc_usage_gen++;
+
 		if (job_ptr && job_ptr->tres_alloc_cnt)
 			job_ptr->tres_alloc_cnt[state_ptr->tres_pos] -= size_mb;
 
@@ -1383,7 +1385,10 @@ extern int bb_post_persist_create(struct job_record *job_ptr,
 	return rc;
 }
 
-/* Log deletion of a persistent burst buffer in the database */
+/*
+ * Log deletion of a persistent burst buffer in the database
+ * NOTE: assoc_mgr association and qos write lock should be set before this.
+ */
 extern int bb_post_persist_delete(bb_alloc_t *bb_alloc, bb_state_t *state_ptr)
 {
 	int rc = SLURM_SUCCESS;
@@ -1459,6 +1464,8 @@ extern int bb_post_persist_delete(bb_alloc_t *bb_alloc, bb_state_t *state_ptr)
 			assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 		}
 
+		g_assoc_usage_gen++;
+
 		if (bb_alloc->qos_ptr) {
 			if (bb_alloc->qos_ptr->usage->grp_used_tres[
 				    state_ptr->tres_pos] >= size_mb)
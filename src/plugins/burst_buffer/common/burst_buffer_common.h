@@ -345,11 +345,15 @@ extern void bb_limit_rem(uint32_t user_id, uint64_t bb_size, char *pool,
  * job_ptr IN - Point to job that created, could be NULL at startup
  * bb_alloc IN - Pointer to persistent burst buffer state info
  * state_ptr IN - Pointer to burst_buffer plugin state info
+ * NOTE: assoc_mgr association and qos write lock should be set before this.
  */
 extern int bb_post_persist_create(struct job_record *job_ptr,
 				  bb_alloc_t *bb_alloc, bb_state_t *state_ptr);
 
-/* Log deletion of a persistent burst buffer in the database */
+/*
+ * Log deletion of a persistent burst buffer in the database
+ * NOTE: assoc_mgr association and qos write lock should be set before this.
+ */
 extern int bb_post_persist_delete(bb_alloc_t *bb_alloc, bb_state_t *state_ptr);
 
 /* Determine if the specified pool name is valid on this system */
@@ -1148,8 +1148,8 @@ static void _load_state(bool init_config)
 	char *end_ptr = NULL;
 	time_t now = time(NULL);
 	uint32_t timeout;
-	assoc_mgr_lock_t assoc_locks = { .assoc = READ_LOCK,
-					 .qos = READ_LOCK,
+	assoc_mgr_lock_t assoc_locks = { .assoc = WRITE_LOCK,
+					 .qos = WRITE_LOCK,
 					 .user = READ_LOCK };
 	bool found_pool;
 	bitstr_t *pools_bitmap;
@@ -2491,8 +2491,8 @@ static void _timeout_bb_rec(void)
 			} else if ((bb_alloc->seen_time + TIME_SLOP) <
 				   bb_state.last_load_time) {
 				assoc_mgr_lock_t assoc_locks =
-					{ .assoc = READ_LOCK,
-					  .qos = READ_LOCK };
+					{ .assoc = WRITE_LOCK,
+					  .qos = WRITE_LOCK };
 				/*
 				 * assoc_mgr needs locking to call
 				 * bb_post_persist_delete
@@ -4666,7 +4666,7 @@ static void *_create_persistent(void *x)
 		unlock_slurmctld(job_write_lock);
 	} else if (resp_msg && strstr(resp_msg, "created")) {
 		assoc_mgr_lock_t assoc_locks =
-			{ .assoc = READ_LOCK, .qos = READ_LOCK };
+			{ .assoc = WRITE_LOCK, .qos = WRITE_LOCK };
 		lock_slurmctld(job_write_lock);
 		job_ptr = find_job_record(create_args->job_id);
 		if (!job_ptr) {
@@ -4807,7 +4807,7 @@ static void *_destroy_persistent(void *x)
 		unlock_slurmctld(job_write_lock);
 	} else {
 		assoc_mgr_lock_t assoc_locks =
-			{ .assoc = READ_LOCK, .qos = READ_LOCK };
+			{ .assoc = WRITE_LOCK, .qos = WRITE_LOCK };
 		/* assoc_mgr needs locking to call bb_post_persist_delete */
 		if (bb_alloc)
 			assoc_mgr_lock(&assoc_locks);
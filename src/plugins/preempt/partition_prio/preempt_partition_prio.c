@@ -39,6 +39,8 @@
 \*****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "slurm/slurm_errno.h"
 
@@ -46,20 +48,29 @@
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/plugin.h"
+#include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/job_scheduler.h"
+#include "src/slurmctld/preempt.h"
 
 const char	plugin_name[]	= "Preempt by partition priority plugin";
 const char	plugin_type[]	= "preempt/partition_prio";
 const uint32_t	plugin_version	= SLURM_VERSION_NUMBER;
 
 static uint32_t _gen_job_prio(struct job_record *job_ptr);
-static int _sort_by_prio(void *x, void *y);
-static int _sort_by_youngest(void *x, void *y);
+static int _sort_by_prio(const void *x, const void *y);
+static int _sort_by_youngest(const void *x, const void *y);
 
 static bool youngest_order = false;
 
+/* Preemption candidates sorted in order of preference, see _cand_sort() */
+static struct job_record **cand_sort = NULL;
+static uint32_t cand_sort_cnt = 0;
+static uint32_t cand_sort_gen = 0;
+static bool cand_sort_valid = false;
+static time_t cand_sort_part_update = (time_t) 0;
+
 extern int init(void)
 {
 	char *sched_params;
@@ -73,14 +84,46 @@ extern int init(void)
 
 extern void fini(void)
 {
-	/* Empty. */
+	xfree(cand_sort);
+	cand_sort_cnt = 0;
+	cand_sort_valid = false;
+}
+
+/*
+ * Refresh cand_sort from the preemption candidates if any job has started,
+ * been resized or removed since it was last sorted or a partition changed
+ */
+static void _cand_sort(void)
+{
+	struct job_record **cand;
+	uint32_t cnt, gen;
+
+	cand = preempt_cand_get(&cnt, &gen);
+	if (cand_sort_valid && (cand_sort_gen == gen) &&
+	    (cand_sort_part_update == last_part_update))
+		return;
+
+	cand_sort_valid = true;
+	cand_sort_gen = gen;
+	cand_sort_part_update = last_part_update;
+	xrealloc(cand_sort, sizeof(struct job_record *) * (cnt + 1));
+	if (cnt)
+		memcpy(cand_sort, cand, sizeof(struct job_record *) * cnt);
+	cand_sort_cnt = cnt;
+	if (youngest_order) {
+		qsort(cand_sort, cnt, sizeof(struct job_record *),
+		      _sort_by_youngest);
+	} else {
+		qsort(cand_sort, cnt, sizeof(struct job_record *),
+		      _sort_by_prio);
+	}
 }
 
 extern List find_preemptable_jobs(struct job_record *job_ptr)
 {
-	ListIterator job_iterator;
 	struct job_record *job_p;
 	List preemptee_job_list = NULL;
+	uint32_t i;
 
 	/* Validate the preemptor job */
 	if (job_ptr == NULL) {
@@ -101,9 +144,10 @@ extern List find_preemptable_jobs(struct job_record *job_ptr)
 		return preemptee_job_list;
 	}
 
-	/* Build an array of pointers to preemption candidates */
-	job_iterator = list_iterator_create(job_list);
-	while ((job_p = (struct job_record *) list_next(job_iterator))) {
+	/* Candidates are already in order, so the list needs no sorting */
+	_cand_sort();
+	for (i = 0; i < cand_sort_cnt; i++) {
+		job_p = cand_sort[i];
 		if (!IS_JOB_RUNNING(job_p) && !IS_JOB_SUSPENDED(job_p))
 			continue;
 		if ((job_p->part_ptr == NULL) ||
@@ -125,12 +169,6 @@ extern List find_preemptable_jobs(struct job_record *job_ptr)
 		}
 		list_append(preemptee_job_list, job_p);
 	}
-	list_iterator_destroy(job_iterator);
-
-	if (preemptee_job_list && youngest_order)
-		list_sort(preemptee_job_list, _sort_by_youngest);
-	else if (preemptee_job_list)
-		list_sort(preemptee_job_list, _sort_by_prio);
 
 	return preemptee_job_list;
 }
@@ -156,12 +194,12 @@ static uint32_t _gen_job_prio(struct job_record *job_ptr)
 	return job_prio;
 }
 
-static int _sort_by_prio(void *x, void *y)
+static int _sort_by_prio(const void *x, const void *y)
 {
 	int rc;
 	uint32_t job_prio1, job_prio2;
-	struct job_record *j1 = *(struct job_record **)x;
-	struct job_record *j2 = *(struct job_record **)y;
+	struct job_record *j1 = *(struct job_record * const *)x;
+	struct job_record *j2 = *(struct job_record * const *)y;
 
 	job_prio1 = _gen_job_prio(j1);
 	job_prio2 = _gen_job_prio(j2);
@@ -176,11 +214,11 @@ static int _sort_by_prio(void *x, void *y)
 	return rc;
 }
 
-static int _sort_by_youngest(void *x, void *y)
+static int _sort_by_youngest(const void *x, const void *y)
 {
 	int rc;
-	struct job_record *j1 = *(struct job_record **) x;
-	struct job_record *j2 = *(struct job_record **) y;
+	struct job_record *j1 = *(struct job_record * const *) x;
+	struct job_record *j2 = *(struct job_record * const *) y;
 
 	if (j1->start_time < j2->start_time)
 		rc = 1;
@@ -168,8 +168,8 @@ extern void priority_p_job_end(struct job_record *job_ptr)
 	slurmdb_assoc_rec_t *assoc_ptr;
 	int i;
 	uint64_t *unused_tres_run_secs;
-	assoc_mgr_lock_t locks = { NO_LOCK, WRITE_LOCK, NO_LOCK,
-				   WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
+	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, WRITE_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 
 	/* No decaying in basic priority. Just remove the total secs. */
 	unused_tres_run_secs = xmalloc(sizeof(uint64_t) * slurmctld_tres_cnt);
@@ -225,6 +225,7 @@ extern void priority_p_job_end(struct job_record *job_ptr)
 		/* now handle all the group limits of the parents */
 		assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 	}
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 	xfree(unused_tres_run_secs);
 
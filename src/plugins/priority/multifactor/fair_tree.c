@@ -47,6 +47,18 @@
 static int  _ft_decay_apply_new_usage(struct job_record *job, time_t *start);
 static void _apply_priority_fs(void);
 
+/*
+ * Sibling arrays for the tree walk are carved out of one contiguous buffer,
+ * sized once per pass, rather than allocated and grown per account. The walk
+ * is depth first, so an array is released (g_sib_used reset to its start)
+ * once its subtree is done. Each association appears in at most one live
+ * array and each array has one NULL terminator, so twice the association
+ * count is enough.
+ */
+static slurmdb_assoc_rec_t **g_sib_buf = NULL;
+static size_t g_sib_size = 0;
+static size_t g_sib_used = 0;
+
 /* Fair Tree code called from the decay thread loop */
 extern void fair_tree_decay(List jobs, time_t start)
 {
@@ -73,6 +85,15 @@ extern void fair_tree_decay(List jobs, time_t start)
 }
 
 
+/* Free memory retained between Fair Tree passes */
+extern void fair_tree_fini(void)
+{
+	xfree(g_sib_buf);
+	g_sib_size = 0;
+	g_sib_used = 0;
+}
+
+
 /* In Fair Tree, usage_efctv is the normalized usage within the account */
 static void _ft_set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc)
 {
@@ -205,34 +226,31 @@ static void _calc_assoc_fs(slurmdb_assoc_rec_t *assoc)
 		assoc->usage->level_fs = S / U;
 }
 
-/* Append list of associations to array
+/* Append list of associations to the array being built at the end of
+ * g_sib_buf.
  * IN list - list of associations
  * IN merged - array of associations to append to
  * IN/OUT merged_size - number of associations in merged array
- * RET - New array. Must be freed.
  */
-static slurmdb_assoc_rec_t** _append_list_to_array(
-	List list, slurmdb_assoc_rec_t** merged,
-	size_t *merged_size)
+static void _append_list_to_array(List list, slurmdb_assoc_rec_t **merged,
+				  size_t *merged_size)
 {
 	ListIterator itr;
 	slurmdb_assoc_rec_t *next;
-	size_t bytes;
 	size_t i = *merged_size;
-	*merged_size += list_count(list);
-
-	/* must be null-terminated, so add one extra slot */
-	bytes = sizeof(slurmdb_assoc_rec_t*) * (*merged_size + 1);
-	merged = xrealloc(merged, bytes);
 
 	itr = list_iterator_create(list);
-	while ((next = list_next(itr)))
+	while ((next = list_next(itr))) {
+		if ((merged - g_sib_buf) + i + 1 >= g_sib_size)
+			fatal("%s: association tree larger than expected",
+			      __func__);
 		merged[i++] = next;
+	}
 	list_iterator_destroy(itr);
 
 	/* null terminate the array */
-	merged[*merged_size] = NULL;
-	return merged;
+	merged[i] = NULL;
+	*merged_size = i;
 }
 
 /* Returns number of tied sibling accounts.
@@ -265,7 +283,8 @@ static size_t _count_tied_accounts(slurmdb_assoc_rec_t** assocs,
  * IN begin - index of first account to merge
  * IN end - index of last account to merge
  * IN assoc_level - depth in the tree (root is 0)
- * RET - Array of the children. Must be freed.
+ * RET - Array of the children, allocated from g_sib_buf. Release it by
+ *	 resetting g_sib_used to its offset once done.
  */
 static slurmdb_assoc_rec_t** _merge_accounts(
 	slurmdb_assoc_rec_t** siblings,
@@ -275,8 +294,7 @@ static slurmdb_assoc_rec_t** _merge_accounts(
 	/* number of associations in merged array */
 	size_t merged_size = 0;
 	/* merged is a null terminated array */
-	slurmdb_assoc_rec_t** merged = (slurmdb_assoc_rec_t **)
-		xmalloc(sizeof(slurmdb_assoc_rec_t *));
+	slurmdb_assoc_rec_t** merged = g_sib_buf + g_sib_used;
 	merged[0] = NULL;
 
 	for (i = begin; i <= end; i++) {
@@ -290,8 +308,9 @@ static slurmdb_assoc_rec_t** _merge_accounts(
 			continue;
 		}
 
-		merged = _append_list_to_array(children, merged, &merged_size);
+		_append_list_to_array(children, merged, &merged_size);
 	}
+	g_sib_used += merged_size + 1;
 	return merged;
 }
 
@@ -376,7 +395,7 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 			/* Skip over any merged accounts */
 			i += merge_count;
 
-			xfree(children);
+			g_sib_used = children - g_sib_buf;
 		}
 		prev_level_fs = assoc->usage->level_fs;
 	}
@@ -390,20 +409,25 @@ static void _apply_priority_fs(void)
 	slurmdb_assoc_rec_t** children = NULL;
 	uint32_t rank = g_user_assoc_count;
 	uint32_t rnt = rank;
-	size_t child_count = 0;
+	size_t child_count = 0, sib_size;
 
 	if (priority_debug)
 		info("Fair Tree fairshare algorithm, starting at root:");
 
 	assoc_mgr_root_assoc->usage->level_fs = (long double) NO_VAL;
 
+	sib_size = (list_count(assoc_mgr_assoc_list) + 1) * 2;
+	if (sib_size > g_sib_size) {
+		g_sib_size = sib_size;
+		xrealloc(g_sib_buf, sizeof(slurmdb_assoc_rec_t *) * g_sib_size);
+	}
+	g_sib_used = 0;
+
 	/* _calc_tree_fs requires an array instead of List */
-	children = _append_list_to_array(
-		assoc_mgr_root_assoc->usage->children_list,
-		children,
-		&child_count);
+	children = g_sib_buf;
+	_append_list_to_array(assoc_mgr_root_assoc->usage->children_list,
+			      children, &child_count);
+	g_sib_used = child_count + 1;
 
 	_calc_tree_fs(children, 0, &rank, &rnt, false);
-
-	xfree(children);
 }
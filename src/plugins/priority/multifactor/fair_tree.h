@@ -43,4 +43,7 @@
 /* Fair Tree code called from the decay thread loop */
 extern void fair_tree_decay(List jobs, time_t start);
 
+/* Free memory retained between Fair Tree passes */
+extern void fair_tree_fini(void);
+
 #endif
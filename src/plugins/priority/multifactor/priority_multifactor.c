@@ -62,6 +62,7 @@
 #include "src/common/slurm_mcs.h"
 #include "src/common/slurm_priority.h"
 #include "src/common/slurm_time.h"
+#include "src/common/tres_vec.h"
 #include "src/common/xstring.h"
 #include "src/common/gres.h"
 
@@ -153,7 +154,18 @@ static double decay_factor = 1; /* The decay factor when decaying time. */
 /* variables defined in prirority_multifactor.h */
 bool priority_debug = 0;
 
+/* New usage of an association, see _update_usage_efctv() */
+typedef struct {
+	slurmdb_assoc_rec_t *assoc;
+	long double usage_norm;
+	long double usage_efctv;
+} usage_efctv_t;
+
 static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc);
+static long double _calc_usage_norm(long double usage_raw);
+static long double _calc_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc,
+					   long double usage_norm,
+					   long double ue_parent);
 static void _set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc);
 
 /*
@@ -207,6 +219,8 @@ static int _apply_decay(double real_decay)
 		qos->usage->grp_used_wall *= real_decay;
 	}
 	list_iterator_destroy(itr);
+	assoc_mgr_usage_decayed(real_decay);
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -253,6 +267,8 @@ static int _reset_usage(void)
 		qos->usage->grp_used_wall = 0;
 	}
 	list_iterator_destroy(itr);
+	assoc_mgr_usage_decayed(0);
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -430,6 +446,120 @@ static int _set_children_usage_efctv(List children_list)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Calculate what _set_children_usage_efctv() would set for the associations
+ * under children_list without setting it, appending the values to *efctv.
+ * ue_parent is the new usage_efctv of the association owning children_list.
+ *
+ * NOTE: acct_mgr_assoc_lock must be read locked before this is called.
+ */
+static void _calc_children_usage_efctv(List children_list,
+				       long double ue_parent,
+				       usage_efctv_t **efctv, int *cnt,
+				       int *size)
+{
+	slurmdb_assoc_rec_t *assoc = NULL;
+	usage_efctv_t *ent;
+	ListIterator itr = NULL;
+
+	if (!children_list || !list_count(children_list))
+		return;
+
+	itr = list_iterator_create(children_list);
+	while ((assoc = list_next(itr))) {
+		if (*cnt >= *size) {
+			*size = MAX(*size * 2, 64);
+			xrealloc(*efctv, sizeof(usage_efctv_t) * *size);
+		}
+		ent = &(*efctv)[(*cnt)++];
+		ent->assoc = assoc;
+		if (assoc->user) {
+			ent->usage_efctv = (long double)NO_VAL;
+			continue;
+		}
+		ent->usage_norm = _calc_usage_norm(assoc->usage->usage_raw);
+		ent->usage_efctv = _calc_assoc_usage_efctv(assoc,
+							   ent->usage_norm,
+							   ue_parent);
+		_calc_children_usage_efctv(assoc->usage->children_list,
+					   ent->usage_efctv, efctv, cnt, size);
+	}
+	list_iterator_destroy(itr);
+}
+
+/*
+ * Recalculate the normalized and effective usage of all associations as
+ * _set_children_usage_efctv() does, but only hold the assoc write lock to
+ * publish the new values. They are calculated under the read lock, so jobs
+ * can still be scheduled meanwhile. g_assoc_usage_gen only changes when the
+ * usage, shares or hierarchy of the associations do, so if it moved in
+ * between the values are recalculated under the write lock instead.
+ */
+static void _update_usage_efctv(void)
+{
+	assoc_mgr_lock_t read_locks = { .assoc = READ_LOCK };
+	assoc_mgr_lock_t write_locks = { .assoc = WRITE_LOCK };
+	usage_efctv_t *efctv = NULL;
+	int cnt = 0, size = 0, i;
+	uint32_t gen;
+
+	assoc_mgr_lock(&read_locks);
+	gen = g_assoc_usage_gen;
+	_calc_children_usage_efctv(assoc_mgr_root_assoc->usage->children_list,
+				   0, &efctv, &cnt, &size);
+	assoc_mgr_unlock(&read_locks);
+
+	assoc_mgr_lock(&write_locks);
+	if (g_assoc_usage_gen != gen) {
+		/* Associations may have been changed or removed since */
+		debug2("%s: associations changed, recalculating usage",
+		       __func__);
+		_set_children_usage_efctv(
+			assoc_mgr_root_assoc->usage->children_list);
+	} else {
+		for (i = 0; i < cnt; i++) {
+			slurmdb_assoc_usage_t *usage = efctv[i].assoc->usage;
+
+			usage->usage_efctv = efctv[i].usage_efctv;
+			if (efctv[i].assoc->user)
+				continue;
+			usage->usage_norm = efctv[i].usage_norm;
+			if (priority_debug)
+				_priority_p_set_assoc_usage_debug(
+					efctv[i].assoc);
+		}
+	}
+	assoc_mgr_unlock(&write_locks);
+
+	xfree(efctv);
+}
+
+
+/*
+ * Jobs of one association are usually adjacent in the job list (job arrays,
+ * bulk submissions), so remember the inputs and result of the last fairshare
+ * factor computed rather than calling pow() again for identical inputs.
+ * Callers hold the job write lock, which serializes access to the cache.
+ */
+static double _calc_fs_factor_cached(long double usage_efctv,
+				     long double shares_norm)
+{
+	static long double last_usage_efctv = -1, last_shares_norm = -1;
+	static uint16_t last_damp_factor = 0;
+	static double last_priority_fs = 0.0;
+
+	if ((usage_efctv != last_usage_efctv) ||
+	    (shares_norm != last_shares_norm) ||
+	    (damp_factor != last_damp_factor)) {
+		last_priority_fs = priority_p_calc_fs_factor(usage_efctv,
+							     shares_norm);
+		last_usage_efctv = usage_efctv;
+		last_shares_norm = shares_norm;
+		last_damp_factor = damp_factor;
+	}
+
+	return last_priority_fs;
+}
 
 /* job_ptr should already have the partition priority and such added here
  * before had we will be adding to it
@@ -475,7 +605,7 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 			     priority_fs);
 		}
 	} else {
-		priority_fs = priority_p_calc_fs_factor(
+		priority_fs = _calc_fs_factor_cached(
 			fs_assoc->usage->usage_efctv,
 			(long double)fs_assoc->usage->shares_norm);
 		if (priority_debug) {
@@ -743,24 +873,40 @@ static time_t _next_reset(uint16_t reset_period, time_t last_reset)
 	return slurm_mktime(&last_tm);
 }
 
+/*
+ * Add tres_run_decay to the usage of a QOS and remove
+ * tres_run_delta from its grp_used_tres_run_secs. The TRES_ARRAY_ENERGY
+ * elements of both arrays must be zero.
+ */
 static void _handle_qos_tres_run_secs(long double *tres_run_decay,
 				      uint64_t *tres_run_delta,
 				      uint32_t job_id,
 				      slurmdb_qos_rec_t *qos)
 {
+	slurmdb_qos_usage_t *usage;
 	int i;
 
 	if (!qos || !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return;
+	usage = qos->usage;
 
-	for (i=0; i<slurmctld_tres_cnt; i++) {
-		if (i == TRES_ARRAY_ENERGY)
-			continue;
-		if (tres_run_decay)
-			qos->usage->usage_tres_raw[i] += tres_run_decay[i];
+	if (tres_run_decay) {
+		for (i = 0; i < slurmctld_tres_cnt; i++)
+			usage->usage_tres_raw[i] += tres_run_decay[i];
+	}
 
-		if (tres_run_delta[i] >
-		    qos->usage->grp_used_tres_run_secs[i]) {
+	if (tres_vec_le(tres_run_delta, usage->grp_used_tres_run_secs,
+			slurmctld_tres_cnt)) {
+		tres_vec_sub(usage->grp_used_tres_run_secs, tres_run_delta,
+			     slurmctld_tres_cnt);
+	} else {
+		for (i = 0; i < slurmctld_tres_cnt; i++) {
+			if (tres_run_delta[i] <=
+			    usage->grp_used_tres_run_secs[i]) {
+				usage->grp_used_tres_run_secs[i] -=
+					tres_run_delta[i];
+				continue;
+			}
 			error("_handle_qos_tres_run_secs: job %u: "
 			      "QOS %s TRES %s grp_used_tres_run_secs "
 			      "underflow, tried to remove %"PRIu64" seconds "
@@ -769,44 +915,63 @@ static void _handle_qos_tres_run_secs(long double *tres_run_decay,
 			      qos->name,
 			      assoc_mgr_tres_name_array[i],
 			      tres_run_delta[i],
-			      qos->usage->grp_used_tres_run_secs[i]);
-			qos->usage->grp_used_tres_run_secs[i] = 0;
-		} else
-			qos->usage->grp_used_tres_run_secs[i] -=
-				tres_run_delta[i];
-
-		if (priority_debug) {
-			info("_handle_qos_tres_run_secs: job %u: "
-			     "Removed %"PRIu64" unused seconds "
-			     "from QOS %s TRES %s "
-			     "grp_used_tres_run_secs = %"PRIu64,
-			     job_id,
-			     tres_run_delta[i],
-			     qos->name,
-			     assoc_mgr_tres_name_array[i],
-			     qos->usage->grp_used_tres_run_secs[i]);
+			      usage->grp_used_tres_run_secs[i]);
+			usage->grp_used_tres_run_secs[i] = 0;
 		}
 	}
+
+	if (!priority_debug)
+		return;
+
+	for (i = 0; i < slurmctld_tres_cnt; i++) {
+		if (i == TRES_ARRAY_ENERGY)
+			continue;
+		info("_handle_qos_tres_run_secs: job %u: "
+		     "Removed %"PRIu64" unused seconds "
+		     "from QOS %s TRES %s "
+		     "grp_used_tres_run_secs = %"PRIu64,
+		     job_id,
+		     tres_run_delta[i],
+		     qos->name,
+		     assoc_mgr_tres_name_array[i],
+		     usage->grp_used_tres_run_secs[i]);
+	}
 }
 
+/*
+ * Add tres_run_decay to the usage of an association and remove
+ * tres_run_delta from its grp_used_tres_run_secs. The TRES_ARRAY_ENERGY
+ * elements of both arrays must be zero.
+ */
 static void _handle_assoc_tres_run_secs(long double *tres_run_decay,
 					uint64_t *tres_run_delta,
 					uint32_t job_id,
 					slurmdb_assoc_rec_t *assoc)
 {
+	slurmdb_assoc_usage_t *usage;
 	int i;
 
 	if (!assoc || !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return;
+	usage = assoc->usage;
 
-	for (i=0; i<slurmctld_tres_cnt; i++) {
-		if (i == TRES_ARRAY_ENERGY)
-			continue;
-		if (tres_run_decay)
-			assoc->usage->usage_tres_raw[i] += tres_run_decay[i];
+	if (tres_run_decay) {
+		for (i = 0; i < slurmctld_tres_cnt; i++)
+			usage->usage_tres_raw[i] += tres_run_decay[i];
+	}
 
-		if (tres_run_delta[i] >
-		    assoc->usage->grp_used_tres_run_secs[i]) {
+	if (tres_vec_le(tres_run_delta, usage->grp_used_tres_run_secs,
+			slurmctld_tres_cnt)) {
+		tres_vec_sub(usage->grp_used_tres_run_secs, tres_run_delta,
+			     slurmctld_tres_cnt);
+	} else {
+		for (i = 0; i < slurmctld_tres_cnt; i++) {
+			if (tres_run_delta[i] <=
+			    usage->grp_used_tres_run_secs[i]) {
+				usage->grp_used_tres_run_secs[i] -=
+					tres_run_delta[i];
+				continue;
+			}
 			error("_handle_assoc_tres_run_secs: job %u: "
 			      "assoc %u TRES %s grp_used_tres_run_secs "
 			      "underflow, tried to remove %"PRIu64" seconds "
@@ -815,24 +980,27 @@ static void _handle_assoc_tres_run_secs(long double *tres_run_decay,
 			      assoc->id,
 			      assoc_mgr_tres_name_array[i],
 			      tres_run_delta[i],
-			      assoc->usage->grp_used_tres_run_secs[i]);
-			assoc->usage->grp_used_tres_run_secs[i] = 0;
-		} else
-			assoc->usage->grp_used_tres_run_secs[i] -=
-				tres_run_delta[i];
-
-		if (priority_debug) {
-			info("_handle_assoc_tres_run_secs: job %u: "
-			     "Removed %"PRIu64" unused seconds "
-			     "from assoc %d TRES %s "
-			     "grp_used_tres_run_secs = %"PRIu64,
-			     job_id,
-			     tres_run_delta[i],
-			     assoc->id,
-			     assoc_mgr_tres_name_array[i],
-			     assoc->usage->grp_used_tres_run_secs[i]);
+			      usage->grp_used_tres_run_secs[i]);
+			usage->grp_used_tres_run_secs[i] = 0;
 		}
 	}
+
+	if (!priority_debug)
+		return;
+
+	for (i = 0; i < slurmctld_tres_cnt; i++) {
+		if (i == TRES_ARRAY_ENERGY)
+			continue;
+		info("_handle_assoc_tres_run_secs: job %u: "
+		     "Removed %"PRIu64" unused seconds "
+		     "from assoc %d TRES %s "
+		     "grp_used_tres_run_secs = %"PRIu64,
+		     job_id,
+		     tres_run_delta[i],
+		     assoc->id,
+		     assoc_mgr_tres_name_array[i],
+		     usage->grp_used_tres_run_secs[i]);
+	}
 }
 
 static void _handle_tres_run_secs(uint64_t *tres_run_delta,
@@ -905,9 +1073,11 @@ static void _init_grp_used_cpu_run_secs(time_t last_ran)
 				(uint64_t)(last_ran - job_ptr->start_time) *
 				job_ptr->tres_alloc_cnt[i];
 		}
+		tres_run_delta[TRES_ARRAY_ENERGY] = 0;
 
 		_handle_tres_run_secs(tres_run_delta, job_ptr);
 	}
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 	list_iterator_destroy(itr);
 	unlock_slurmctld(job_read_lock);
@@ -1047,6 +1217,10 @@ static int _apply_new_usage(struct job_record *job_ptr,
 			tres_run_nodecay[i] = (long double)run_nodecay *
 				(long double)job_ptr->tres_alloc_cnt[i];
 		}
+		/* ENERGY is not tracked in grp_used_tres_run_secs */
+		tres_run_delta[TRES_ARRAY_ENERGY] = 0;
+		tres_run_decay[TRES_ARRAY_ENERGY] = 0;
+		tres_run_nodecay[TRES_ARRAY_ENERGY] = 0;
 	}
 
 	assoc = job_ptr->assoc_ptr;
@@ -1123,6 +1297,7 @@ static int _apply_new_usage(struct job_record *job_ptr,
 
 		assoc = assoc->usage->parent_assoc_ptr;
 	}
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 	return 1;
 }
@@ -1160,8 +1335,6 @@ static void *_decay_thread(void *no_data)
 	/* Write lock on jobs, read lock on nodes and partitions */
 	slurmctld_lock_t job_write_lock =
 		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
-	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
-				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "decay", NULL, NULL, NULL) < 0) {
@@ -1277,12 +1450,8 @@ static void *_decay_thread(void *no_data)
 
 		/* Calculate all the normalized usage unless this is Fair Tree;
 		 * it handles these calculations during its tree traversal */
-		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
-			assoc_mgr_lock(&locks);
-			_set_children_usage_efctv(
-				assoc_mgr_root_assoc->usage->children_list);
-			assoc_mgr_unlock(&locks);
-		}
+		if (!(flags & PRIORITY_FLAGS_FAIR_TREE))
+			_update_usage_efctv();
 
 		if (!g_last_ran)
 			goto get_usage;
@@ -1520,9 +1689,10 @@ static void _set_norm_shares(List children_list)
 }
 
 
-static void _depth_oblivious_set_usage_efctv(slurmdb_assoc_rec_t *assoc)
+static long double _depth_oblivious_calc_usage_efctv(
+	slurmdb_assoc_rec_t *assoc, long double usage_norm, long double ue_parent)
 {
-	long double ratio_p, ratio_l, k, f, ratio_s;
+	long double ratio_p, ratio_l, k, f, ratio_s, usage_efctv;
 	slurmdb_assoc_rec_t *parent_assoc = NULL;
 	ListIterator sib_itr = NULL;
 	slurmdb_assoc_rec_t *sibling = NULL;
@@ -1567,23 +1737,27 @@ static void _depth_oblivious_set_usage_efctv(slurmdb_assoc_rec_t *assoc)
 
 	if (assoc->usage->shares_norm &&
 	    parent_assoc->usage->shares_norm &&
-	    parent_assoc->usage->usage_efctv &&
-	    assoc->usage->usage_norm) {
-		ratio_p = (parent_assoc->usage->usage_efctv /
-			   parent_assoc->usage->shares_norm);
+	    ue_parent && usage_norm) {
+		ratio_p = (ue_parent / parent_assoc->usage->shares_norm);
 
 		ratio_s = 0;
 		sib_itr = list_iterator_create(
 			parent_assoc->usage->children_list);
 		while ((sibling = list_next(sib_itr))) {
-			if(sibling->shares_raw != SLURMDB_FS_USE_PARENT)
+			if (sibling->shares_raw == SLURMDB_FS_USE_PARENT)
+				continue;
+			if (sibling == assoc)
+				ratio_s += usage_norm;
+			else if (sibling->user)
 				ratio_s += sibling->usage->usage_norm;
+			else
+				ratio_s += _calc_usage_norm(
+					sibling->usage->usage_raw);
 		}
 		list_iterator_destroy(sib_itr);
 		ratio_s /= parent_assoc->usage->shares_norm;
 
-		ratio_l = (assoc->usage->usage_norm /
-			   assoc->usage->shares_norm) / ratio_s;
+		ratio_l = (usage_norm / assoc->usage->shares_norm) / ratio_s;
 #if defined(__FreeBSD__)
 		if (!ratio_p || !ratio_l
 		    || log(ratio_p) * log(ratio_l) >= 0) {
@@ -1592,8 +1766,7 @@ static void _depth_oblivious_set_usage_efctv(slurmdb_assoc_rec_t *assoc)
 			k = 1 / (1 + pow(f * log(ratio_p), 2));
 		}
 
-		assoc->usage->usage_efctv =
-			ratio_p * pow(ratio_l, k) *
+		usage_efctv = ratio_p * pow(ratio_l, k) *
 			assoc->usage->shares_norm;
 #else
 		if (!ratio_p || !ratio_l
@@ -1603,8 +1776,7 @@ static void _depth_oblivious_set_usage_efctv(slurmdb_assoc_rec_t *assoc)
 			k = 1 / (1 + powl(f * logl(ratio_p), 2));
 		}
 
-		assoc->usage->usage_efctv =
-			ratio_p * pow(ratio_l, k) *
+		usage_efctv = ratio_p * pow(ratio_l, k) *
 			assoc->usage->shares_norm;
 #endif
 
@@ -1615,38 +1787,37 @@ static void _depth_oblivious_set_usage_efctv(slurmdb_assoc_rec_t *assoc)
 			     assoc->usage->parent_assoc_ptr->acct,
 			     assoc->usage->fs_assoc_ptr->acct,
 			     ratio_p, ratio_l, k,
-			     assoc->usage->shares_norm,
-			     assoc->usage->usage_efctv);
+			     assoc->usage->shares_norm, usage_efctv);
 		}
 	} else {
-		assoc->usage->usage_efctv = assoc->usage->usage_norm;
+		usage_efctv = usage_norm;
 		if (priority_debug) {
 			info("Effective usage for %s %s off %s(%s) %Lf",
 			     child, child_str,
 			     assoc->usage->parent_assoc_ptr->acct,
 			     assoc->usage->fs_assoc_ptr->acct,
-			     assoc->usage->usage_efctv);
+			     usage_efctv);
 		}
 	}
+
+	return usage_efctv;
 }
 
-static void _set_usage_efctv(slurmdb_assoc_rec_t *assoc)
+static long double _calc_usage_efctv(slurmdb_assoc_rec_t *assoc,
+				     long double ua_child,
+				     long double ue_parent)
 {
 	/* Variable names taken from HTML documentation */
-	long double ua_child = assoc->usage->usage_norm;
-	long double ue_parent =
-		assoc->usage->fs_assoc_ptr->usage->usage_efctv;
 	uint32_t s_child = assoc->shares_raw;
 	uint32_t s_all_siblings = assoc->usage->level_shares;
 
 	/* If no user in the account has shares, avoid division by zero by
 	 * setting usage_efctv to the parent's usage_efctv */
 	if (!s_all_siblings)
-		assoc->usage->usage_efctv = ue_parent;
-	else
-		assoc->usage->usage_efctv = ua_child +
-			(ue_parent - ua_child) *
-			(s_child / (long double) s_all_siblings);
+		return ue_parent;
+
+	return ua_child + (ue_parent - ua_child) *
+		(s_child / (long double) s_all_siblings);
 }
 
 
@@ -1753,6 +1924,8 @@ int fini ( void )
 	if (decay_handler_thread)
 		pthread_join(decay_handler_thread, NULL);
 
+	fair_tree_fini();
+
 	return SLURM_SUCCESS;
 }
 
@@ -1798,23 +1971,28 @@ extern void priority_p_reconfig(bool assoc_clear)
 }
 
 
-extern void set_assoc_usage_norm(slurmdb_assoc_rec_t *assoc)
+static long double _calc_usage_norm(long double usage_raw)
 {
-	/* If root usage is 0, there is no usage anywhere. */
-	if (!assoc_mgr_root_assoc->usage->usage_raw) {
-		assoc->usage->usage_norm = 0L;
-		return;
-	}
+	long double usage_norm;
 
-	assoc->usage->usage_norm = assoc->usage->usage_raw
-		/ assoc_mgr_root_assoc->usage->usage_raw;
+	/* If root usage is 0, there is no usage anywhere. */
+	if (!assoc_mgr_root_assoc->usage->usage_raw)
+		return 0L;
 
+	usage_norm = usage_raw / assoc_mgr_root_assoc->usage->usage_raw;
 
 	/* This is needed in case someone changes the half-life on the
 	 * fly and now we have used more time than is available under
 	 * the new config */
-	if (assoc->usage->usage_norm > 1L)
-		assoc->usage->usage_norm = 1L;
+	if (usage_norm > 1L)
+		usage_norm = 1L;
+
+	return usage_norm;
+}
+
+extern void set_assoc_usage_norm(slurmdb_assoc_rec_t *assoc)
+{
+	assoc->usage->usage_norm = _calc_usage_norm(assoc->usage->usage_raw);
 }
 
 
@@ -2009,6 +2187,23 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 	if (!job_ptr->prio_factors) {
 		job_ptr->prio_factors =
 			xmalloc(sizeof(priority_factors_object_t));
+	} else if (weight_tres && job_ptr->prio_factors->priority_tres &&
+		   (job_ptr->prio_factors->tres_cnt == slurmctld_tres_cnt)) {
+		/*
+		 * Recalculated every PriorityCalcPeriod, so keep the TRES
+		 * arrays rather than reallocating them for every job.
+		 */
+		double *priority_tres = job_ptr->prio_factors->priority_tres;
+		double *tres_weights = job_ptr->prio_factors->tres_weights;
+
+		memset(job_ptr->prio_factors, 0,
+		       sizeof(priority_factors_object_t));
+		memset(priority_tres, 0, sizeof(double) * slurmctld_tres_cnt);
+		memcpy(tres_weights, weight_tres,
+		       sizeof(double) * slurmctld_tres_cnt);
+		job_ptr->prio_factors->priority_tres = priority_tres;
+		job_ptr->prio_factors->tres_weights = tres_weights;
+		job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
 	} else {
 		xfree(job_ptr->prio_factors->tres_weights);
 		xfree(job_ptr->prio_factors->priority_tres);
@@ -2157,23 +2352,32 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 }
 
 
+/* Calculate usage_efctv based on algorithm-specific code given the
+ * association's usage_norm and the usage_efctv of its fs_assoc_ptr.
+ */
+static long double _calc_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc,
+					   long double usage_norm,
+					   long double ue_parent)
+{
+	if (assoc->usage->fs_assoc_ptr == assoc_mgr_root_assoc)
+		return usage_norm;
+	else if (assoc->shares_raw == SLURMDB_FS_USE_PARENT)
+		return ue_parent;
+	else if (flags & PRIORITY_FLAGS_DEPTH_OBLIVIOUS)
+		return _depth_oblivious_calc_usage_efctv(assoc, usage_norm,
+							 ue_parent);
+	else
+		return _calc_usage_efctv(assoc, usage_norm, ue_parent);
+}
+
 /* Set usage_efctv based on algorithm-specific code. Fair Tree sets this
  * elsewhere.
  */
 static void _set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc)
 {
-	if (assoc->usage->fs_assoc_ptr == assoc_mgr_root_assoc)
-		assoc->usage->usage_efctv = assoc->usage->usage_norm;
-	else if (assoc->shares_raw == SLURMDB_FS_USE_PARENT) {
-		slurmdb_assoc_rec_t *parent_assoc =
-			assoc->usage->fs_assoc_ptr;
-
-		assoc->usage->usage_efctv =
-			parent_assoc->usage->usage_efctv;
-	} else if (flags & PRIORITY_FLAGS_DEPTH_OBLIVIOUS)
-		_depth_oblivious_set_usage_efctv(assoc);
-	else
-		_set_usage_efctv(assoc);
+	assoc->usage->usage_efctv = _calc_assoc_usage_efctv(
+		assoc, assoc->usage->usage_norm,
+		assoc->usage->fs_assoc_ptr->usage->usage_efctv);
 }
 
 
@@ -2215,7 +2419,7 @@ static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc)
 		     parent_assoc->usage->usage_efctv);
 	} else if (flags & PRIORITY_FLAGS_DEPTH_OBLIVIOUS) {
 		/* Unfortunately, this must be handled inside of
-		 * _depth_oblivious_set_usage_efctv */
+		 * _depth_oblivious_calc_usage_efctv */
 	} else {
 		info("Effective usage for %s %s off %s(%s) "
 		     "%Lf + ((%Lf - %Lf) * %d / %d) = %Lf",
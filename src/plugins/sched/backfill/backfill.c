@@ -90,6 +90,7 @@
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
+#include "src/slurmctld/power_save.h"
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
@@ -110,6 +111,7 @@ typedef struct node_space_map {
 	time_t begin_time;
 	time_t end_time;
 	bitstr_t *avail_bitmap;
+	bitstr_t *resv_bitmap;	/* nodes in full node reservations or NULL */
 	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
 
@@ -177,19 +179,37 @@ static int max_backfill_job_per_user = 0;
 static int max_backfill_job_per_user_part = 0;
 static int max_backfill_jobs_start = 0;
 static bool backfill_continue = false;
+static bool backfill_licenses = false;
 static bool assoc_limit_stop = false;
 static int defer_rpc_cnt = 0;
 static int sched_timeout = SCHED_TIMEOUT;
 static int yield_sleep   = YIELD_SLEEP;
 static List pack_job_list = NULL;
 
+/*
+ * Preemption candidates of the job and partition last tested by
+ * _try_sched(), reused across its time slots. Cleared whenever the locks
+ * are released, as jobs may start, end or be purged meanwhile.
+ */
+static List bf_preemptee_list = NULL;
+static struct job_record *bf_preemptee_job_ptr = NULL;
+static uint32_t bf_preemptee_job_id = 0;
+static struct part_record *bf_preemptee_part_ptr = NULL;
+
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
 			     node_space_map_t *node_space,
 			     int *node_space_recs);
+static void _add_booting_nodes(node_space_map_t *node_space,
+			       int *node_space_recs);
+static void _add_resv_nodes(time_t start_time, time_t end_time,
+			    bitstr_t *node_bitmap,
+			    node_space_map_t *node_space,
+			    int *node_space_recs);
 static int  _attempt_backfill(void);
 static int  _clear_job_start_times(void *x, void *arg);
+static void _clear_preemptee_candidates(void);
 static int  _clear_qos_blocked_times(void *x, void *arg);
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2);
 static uint32_t _get_job_max_tl(struct job_record *job_ptr, time_t now,
@@ -202,6 +222,7 @@ static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static uint32_t _my_sleep(int usec);
+static List _get_preemptee_candidates(struct job_record *job_ptr);
 static int  _num_feature_count(struct job_record *job_ptr, bool *has_xand,
 			       bool *has_xor);
 static int  _pack_find_map(void *x, void *key);
@@ -218,6 +239,10 @@ static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
 static bool _test_resv_overlap(node_space_map_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve);
+static void _merge_node_space(node_space_map_t *node_space);
+static uint32_t _split_node_space(uint32_t start_time, uint32_t end_reserve,
+				  node_space_map_t *node_space,
+				  int *node_space_recs);
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
 		       uint32_t req_nodes, bitstr_t *exc_core_bitmap);
@@ -267,6 +292,12 @@ static void _dump_node_space_table(node_space_map_t *node_space_ptr)
 		info("Begin:%s End:%s Nodes:%s",
 		     begin_buf, end_buf, node_list);
 		xfree(node_list);
+		if (node_space_ptr[i].resv_bitmap) {
+			node_list = bitmap2node_name(
+					node_space_ptr[i].resv_bitmap);
+			info("  Reserved:%s", node_list);
+			xfree(node_list);
+		}
 		if ((i = node_space_ptr[i].next) == 0)
 			break;
 	}
@@ -338,6 +369,35 @@ static int _clear_qos_blocked_times(void *x, void *arg)
 	return 0;
 }
 
+/* Release the preemption candidates cached by _get_preemptee_candidates() */
+static void _clear_preemptee_candidates(void)
+{
+	FREE_NULL_LIST(bf_preemptee_list);
+	bf_preemptee_job_ptr = NULL;
+	bf_preemptee_job_id = 0;
+	bf_preemptee_part_ptr = NULL;
+}
+
+/*
+ * Return the preemption candidates of a job in its current partition.
+ * The candidates depend upon job_ptr->part_ptr, so they are only reused
+ * while the same job is tested in the same partition.
+ * RET list owned by this module, do not free
+ */
+static List _get_preemptee_candidates(struct job_record *job_ptr)
+{
+	if ((bf_preemptee_job_ptr != job_ptr) ||
+	    (bf_preemptee_job_id != job_ptr->job_id) ||
+	    (bf_preemptee_part_ptr != job_ptr->part_ptr)) {
+		FREE_NULL_LIST(bf_preemptee_list);
+		bf_preemptee_list = slurm_find_preemptable_jobs(job_ptr);
+		bf_preemptee_job_ptr = job_ptr;
+		bf_preemptee_job_id = job_ptr->job_id;
+		bf_preemptee_part_ptr = job_ptr->part_ptr;
+	}
+	return bf_preemptee_list;
+}
+
 /*
  * Attempt to schedule a specific job on specific available nodes
  * IN job_ptr - job to schedule
@@ -394,7 +454,7 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			     == SLURM_SUCCESS) &&
 			    (bit_set_count(*avail_bitmap) >= feat_min_node)) {
 				preemptee_candidates =
-					slurm_find_preemptable_jobs(job_ptr);
+					_get_preemptee_candidates(job_ptr);
 				rc = select_g_job_test(job_ptr, *avail_bitmap,
 						       feat_min_node, max_nodes,
 						       req_nodes,
@@ -462,7 +522,7 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			     == SLURM_SUCCESS) &&
 			    (bit_set_count(*avail_bitmap) >= min_nodes)) {
 				preemptee_candidates =
-					slurm_find_preemptable_jobs(job_ptr);
+					_get_preemptee_candidates(job_ptr);
 				rc = select_g_job_test(job_ptr, *avail_bitmap,
 						       min_nodes, max_nodes,
 						       req_nodes,
@@ -504,7 +564,7 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			rc = ESLURM_NODES_BUSY;
 		} else {
 			preemptee_candidates =
-					slurm_find_preemptable_jobs(job_ptr);
+					_get_preemptee_candidates(job_ptr);
 			rc = select_g_job_test(job_ptr, *avail_bitmap,
 					       min_nodes, max_nodes, req_nodes,
 					       SELECT_MODE_WILL_RUN,
@@ -520,7 +580,7 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		time_t now = time(NULL);
 		char str[100];
 
-		preemptee_candidates = slurm_find_preemptable_jobs(job_ptr);
+		preemptee_candidates = _get_preemptee_candidates(job_ptr);
 		orig_shared = job_ptr->details->share_res;
 		job_ptr->details->share_res = 0;
 		tmp_bitmap = bit_copy(*avail_bitmap);
@@ -555,7 +615,6 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 			FREE_NULL_BITMAP(tmp_bitmap);
 	}
 
-	FREE_NULL_LIST(preemptee_candidates);
 	return rc;
 }
 
@@ -814,6 +873,13 @@ static void _load_config(void)
 		backfill_continue = false;
 	}
 
+	/* bf_licenses plans future starts of license limited jobs */
+	if (sched_params && (xstrcasestr(sched_params, "bf_licenses"))) {
+		backfill_licenses = true;
+	} else {
+		backfill_licenses = false;
+	}
+
 	if (sched_params && (xstrcasestr(sched_params, "assoc_limit_stop"))) {
 		assoc_limit_stop = true;
 	} else {
@@ -995,6 +1061,7 @@ static int _yield_locks(int usec)
 	node_update = last_node_update;
 	part_update = last_part_update;
 
+	_clear_preemptee_candidates();
 	unlock_slurmctld(all_locks);
 	while (!stop_backfill) {
 		bf_sleep_usec += _my_sleep(usec);
@@ -1109,9 +1176,13 @@ static int _attempt_backfill(void)
 	time_t now, sched_start, later_start, start_res, resv_end, window_end;
 	time_t pack_time, orig_sched_start, orig_start_time = (time_t) 0;
 	node_space_map_t *node_space;
+	resv_node_span_t *resv_spans = NULL;
+	int boot_cnt, resv_span_cnt = 0, init_space_recs;
+	time_t resv_update = (time_t) 0;
+	bool resv_merged = false, use_resv_nodes;
 	user_part_rec_t *bf_user_part_ptr = NULL;
 	struct timeval bf_time1, bf_time2;
-	int rc = 0, error_code;
+	int rc = 0, error_code, lic_rc;
 	int job_test_count = 0, test_time_count = 0, pend_time;
 	uint32_t *uid = NULL, nuser = 0, bf_parts = 0;
 	uint32_t *bf_part_jobs = NULL, *bf_part_resv = NULL;
@@ -1126,7 +1197,9 @@ static int _attempt_backfill(void)
 	uint32_t test_array_job_id = 0;
 	uint32_t test_array_count = 0;
 	uint32_t job_no_reserve;
-	bool resv_overlap = false;
+	bool resv_overlap = false, lic_avail;
+	List bf_license_list = NULL;
+	time_t lic_later;
 	uint8_t save_share_res = 0, save_whole_node = 0;
 	int test_fini;
 	int user_part_inx1 = -1, user_part_inx2 = -1;
@@ -1185,16 +1258,42 @@ static int _attempt_backfill(void)
 	slurmctld_diag_stats.bf_when_last_cycle = now;
 	slurmctld_diag_stats.bf_active = 1;
 
+	window_end = sched_start + backfill_window;
+	/*
+	 * Track the nodes of full node reservations in node_space once per
+	 * cycle rather than in job_test_resv() for every job and start time.
+	 * A reservation change later in this second would go unnoticed.
+	 */
+	if (time(NULL) > last_resv_update) {
+		resv_update = last_resv_update;
+		resv_spans = resv_full_node_spans(sched_start, window_end,
+						  &resv_span_cnt);
+		resv_merged = true;
+	}
+	boot_cnt = bit_overlap(avail_node_bitmap, booting_node_bitmap);
 	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
+			     (max_backfill_job_cnt * 2 + 1 +
+			      (resv_span_cnt + boot_cnt) * 2));
 	node_space[0].begin_time = sched_start;
-	window_end = sched_start + backfill_window;
 	node_space[0].end_time = window_end;
 	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
 	node_space[0].next = 0;
 	node_space_recs = 1;
+	for (i = 0; i < resv_span_cnt; i++) {
+		_add_resv_nodes(resv_spans[i].start_time,
+				resv_spans[i].end_time,
+				resv_spans[i].node_bitmap,
+				node_space, &node_space_recs);
+	}
+	xfree(resv_spans);
+	if (boot_cnt)
+		_add_booting_nodes(node_space, &node_space_recs);
+	init_space_recs = node_space_recs - 1;
 	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 		_dump_node_space_table(node_space);
+	if (backfill_licenses)
+		bf_license_list = bf_licenses_initial(now);
+	power_save_plan_begin();
 
 	if (bf_job_part_count_reserve || max_backfill_job_per_part) {
 		ListIterator part_iterator;
@@ -1658,9 +1757,11 @@ next_task:
 			continue;
 		}
 
+		/* bf_licenses: jobs lacking licenses now may start later */
 		if ((!job_independent(job_ptr, 0)) ||
-		    (license_job_test(job_ptr, time(NULL), true) !=
-		     SLURM_SUCCESS)) {
+		    (((lic_rc = license_job_test(job_ptr, time(NULL), true)) !=
+		      SLURM_SUCCESS) &&
+		     (!bf_license_list || (lic_rc != EAGAIN)))) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				info("backfill: %pJ not runable now", job_ptr);
 			continue;
@@ -1812,9 +1913,22 @@ next_task:
 		start_res = MAX(later_start, pack_time);
 		resv_end = 0;
 		later_start = 0;
+		/* Full node reservations changed since merged in node_space */
+		if (resv_merged && (last_resv_update != resv_update))
+			resv_merged = false;
+		use_resv_nodes = resv_merged && !job_ptr->resv_name &&
+				 !job_ptr->details->req_node_bitmap;
 		/* Determine impact of any advance reservations */
-		j = job_test_resv(job_ptr, &start_res, true, &avail_bitmap,
-				  &exc_core_bitmap, &resv_overlap, false);
+		if (use_resv_nodes) {
+			j = job_test_resv_skip_full(job_ptr, &start_res, true,
+						    &avail_bitmap,
+						    &exc_core_bitmap,
+						    &resv_overlap);
+		} else {
+			j = job_test_resv(job_ptr, &start_res, true,
+					  &avail_bitmap, &exc_core_bitmap,
+					  &resv_overlap, false);
+		}
 		if (j != SLURM_SUCCESS) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				info("backfill: %pJ reservation defer",
@@ -1828,8 +1942,6 @@ next_task:
 			end_time = (time_limit * 60) + now;
 		if (end_time < now)	/* Overflow 32-bits */
 			end_time = INFINITE;
-		if (resv_overlap)
-			resv_end = find_resv_end(start_res);
 		/* Identify usable nodes for this job */
 		bit_and(avail_bitmap, part_ptr->node_bitmap);
 		bit_and(avail_bitmap, up_node_bitmap);
@@ -1844,15 +1956,36 @@ next_task:
 			else if (node_space[j].begin_time <= end_time) {
 				bit_and(avail_bitmap,
 					node_space[j].avail_bitmap);
+				if (use_resv_nodes &&
+				    node_space[j].resv_bitmap) {
+					bit_and_not(avail_bitmap,
+						    node_space[j].resv_bitmap);
+					if (bit_overlap(part_ptr->node_bitmap,
+						node_space[j].resv_bitmap))
+						resv_overlap = true;
+				}
 			} else
 				break;
 			if ((j = node_space[j].next) == 0)
 				break;
 		}
+		if (resv_overlap)
+			resv_end = find_resv_end(start_res);
 		if (resv_end && (++resv_end < window_end) &&
 		    ((later_start == 0) || (resv_end < later_start))) {
 			later_start = resv_end;
 		}
+		lic_avail = true;
+		if (bf_license_list &&
+		    !bf_licenses_avail(bf_license_list, job_ptr, start_res,
+				       end_time, &lic_later)) {
+			/* No start before lic_later can get the licenses */
+			lic_avail = false;
+			if ((lic_later == 0) || (lic_later >= window_end))
+				later_start = 0;
+			else
+				later_start = MAX(later_start, lic_later);
+		}
 
 		if (job_ptr->details->exc_node_bitmap) {
 			bit_and_not(avail_bitmap,
@@ -1864,7 +1997,8 @@ next_task:
 		 *	nodes lack features OR
 		 *	no change since previously tested nodes (only changes
 		 *	in other partition nodes) */
-		if ((bit_set_count(avail_bitmap) < min_nodes) ||
+		if (!lic_avail ||
+		    (bit_set_count(avail_bitmap) < min_nodes) ||
 		    ((job_ptr->details->req_node_bitmap) &&
 		     (!bit_super_set(job_ptr->details->req_node_bitmap,
 				     avail_bitmap))) ||
@@ -2176,6 +2310,9 @@ skip_start:
 				later_start = 0;
 			} else {
 				/* Started this job, move to next one */
+				bf_licenses_deduct(bf_license_list, job_ptr,
+						   job_ptr->start_time,
+						   job_ptr->end_time);
 				reject_array_job_id = 0;
 				reject_array_part   = NULL;
 
@@ -2256,7 +2393,8 @@ skip_start:
 			continue;
 		}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
+		if ((node_space_recs - init_space_recs) >=
+		    max_backfill_job_cnt) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				info("backfill: table size limit of %u reached",
 				     max_backfill_job_cnt);
@@ -2283,6 +2421,23 @@ skip_start:
 			break;
 		}
 
+		if ((job_ptr->start_time > now) && bf_license_list &&
+		    !bf_licenses_avail(bf_license_list, job_ptr, start_time,
+				       end_reserve, &lic_later)) {
+			/* Planned start time lacks the required licenses */
+			job_ptr->start_time = 0;
+			if ((lic_later == 0) || (lic_later >= window_end)) {
+				_set_job_time_limit(job_ptr, orig_time_limit);
+				if (orig_start_time != 0) {
+					/* Can start in different partition */
+					job_ptr->start_time = orig_start_time;
+				}
+				continue;
+			}
+			later_start = lic_later;
+			goto TRY_LATER;
+		}
+
 		if ((job_ptr->start_time > now) &&
 		    (job_ptr->state_reason != WAIT_BURST_BUFFER_RESOURCE) &&
 		    (job_ptr->state_reason != WAIT_BURST_BUFFER_STAGING) &&
@@ -2377,9 +2532,12 @@ skip_start:
 		reject_array_part   = NULL;
 		xfree(job_ptr->sched_nodes);
 		job_ptr->sched_nodes = bitmap2node_name(avail_bitmap);
+		power_save_plan_nodes(avail_bitmap, start_time);
 		bit_not(avail_bitmap);
 		_add_reservation(start_time, end_reserve,
 				 avail_bitmap, node_space, &node_space_recs);
+		bf_licenses_deduct(bf_license_list, job_ptr, start_time,
+				   end_reserve);
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_node_space_table(node_space);
 		if ((orig_start_time != 0) &&
@@ -2433,9 +2591,13 @@ skip_start:
 	FREE_NULL_BITMAP(avail_bitmap);
 	FREE_NULL_BITMAP(exc_core_bitmap);
 	FREE_NULL_BITMAP(resv_bitmap);
+	bf_licenses_free(bf_license_list);
+	power_save_plan_end();
+	_clear_preemptee_candidates();
 
 	for (i = 0; ; ) {
 		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
+		FREE_NULL_BITMAP(node_space[i].resv_bitmap);
 		if ((i = node_space[i].next) == 0)
 			break;
 	}
@@ -2627,8 +2789,7 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     node_space_map_t *node_space,
 			     int *node_space_recs)
 {
-	bool placed = false;
-	int i, j;
+	int j;
 
 #if 0	
 	info("add job start:%u end:%u", start_time, end_reserve);
@@ -2641,6 +2802,102 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 	}
 #endif
 
+	start_time = _split_node_space(start_time, end_reserve, node_space,
+				       node_space_recs);
+
+	for (j = 0; ; ) {
+		if ((node_space[j].begin_time >= start_time) &&
+		    (node_space[j].end_time <= end_reserve))
+			bit_and(node_space[j].avail_bitmap, res_bitmap);
+		if ((node_space[j].begin_time >= end_reserve) ||
+		    ((j = node_space[j].next) == 0))
+			break;
+	}
+
+	_merge_node_space(node_space);
+}
+
+/*
+ * Nodes resumed by power_save for a planned job start remain in
+ * avail_node_bitmap while booting. Make each of them unavailable until
+ * ResumeTimeout after its boot request, when it should be up.
+ */
+static void _add_booting_nodes(node_space_map_t *node_space,
+			       int *node_space_recs)
+{
+	struct node_record *node_ptr;
+	bitstr_t *boot_bitmap;
+	time_t ready_time, sched_start = node_space[0].begin_time;
+	int i, i_first, i_last;
+
+	i_first = bit_ffs(booting_node_bitmap);
+	if (i_first < 0)
+		return;
+	i_last = bit_fls(booting_node_bitmap);
+	boot_bitmap = bit_alloc(node_record_count);
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(booting_node_bitmap, i) ||
+		    !bit_test(avail_node_bitmap, i))
+			continue;
+		node_ptr = node_record_table_ptr + i;
+		ready_time = node_ptr->boot_req_time +
+			     slurmctld_conf.resume_timeout;
+		if (ready_time <= sched_start)
+			continue;
+		ready_time = MIN(ready_time, sched_start + backfill_window);
+		bit_nset(boot_bitmap, 0, node_record_count - 1);
+		bit_clear(boot_bitmap, i);
+		_add_reservation(sched_start, ready_time, boot_bitmap,
+				 node_space, node_space_recs);
+	}
+	FREE_NULL_BITMAP(boot_bitmap);
+}
+
+/*
+ * Record the nodes of a full node reservation in the scheduling table.
+ * Unlike nodes reserved for pending jobs, these are only removed from the
+ * nodes available to jobs outside of any reservation.
+ */
+static void _add_resv_nodes(time_t start_time, time_t end_time,
+			    bitstr_t *node_bitmap,
+			    node_space_map_t *node_space,
+			    int *node_space_recs)
+{
+	int j;
+
+	end_time = MIN(end_time, node_space[0].begin_time + backfill_window);
+	start_time = _split_node_space(start_time, end_time, node_space,
+				       node_space_recs);
+
+	for (j = 0; ; ) {
+		if ((node_space[j].begin_time >= start_time) &&
+		    (node_space[j].end_time <= end_time)) {
+			if (node_space[j].resv_bitmap)
+				bit_or(node_space[j].resv_bitmap, node_bitmap);
+			else
+				node_space[j].resv_bitmap =
+					bit_copy(node_bitmap);
+		}
+		if ((node_space[j].begin_time >= end_time) ||
+		    ((j = node_space[j].next) == 0))
+			break;
+	}
+
+	_merge_node_space(node_space);
+}
+
+/*
+ * Split scheduling table records so that records begin at start_time and
+ *	end_reserve
+ * RET start_time, moved to the beginning of the table if earlier
+ */
+static uint32_t _split_node_space(uint32_t start_time, uint32_t end_reserve,
+				  node_space_map_t *node_space,
+				  int *node_space_recs)
+{
+	bool placed = false;
+	int i, j;
+
 	start_time = MAX(start_time, node_space[0].begin_time);
 	for (j = 0; ; ) {
 		if (node_space[j].end_time > start_time) {
@@ -2651,6 +2908,9 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			node_space[j].end_time = start_time;
 			node_space[i].avail_bitmap =
 				bit_copy(node_space[j].avail_bitmap);
+			if (node_space[j].resv_bitmap)
+				node_space[i].resv_bitmap =
+					bit_copy(node_space[j].resv_bitmap);
 			node_space[i].next = node_space[j].next;
 			node_space[j].next = i;
 			(*node_space_recs)++;
@@ -2672,6 +2932,10 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 					node_space[i].avail_bitmap =
 						bit_copy(node_space[j].
 							 avail_bitmap);
+					if (node_space[j].resv_bitmap)
+						node_space[i].resv_bitmap =
+							bit_copy(node_space[j].
+								 resv_bitmap);
 					node_space[i].next = node_space[j].next;
 					node_space[j].next = i;
 					(*node_space_recs)++;
@@ -2687,28 +2951,32 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			break;
 	}
 
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
-			break;
-	}
+	return start_time;
+}
+
+/* Drop records with identical bitmaps (up to one record).
+ * This can significantly improve performance of the backfill tests. */
+static void _merge_node_space(node_space_map_t *node_space)
+{
+	int i, j;
 
-	/* Drop records with identical bitmaps (up to one record).
-	 * This can significantly improve performance of the backfill tests. */
 	for (i = 0; ; ) {
 		if ((j = node_space[i].next) == 0)
 			break;
 		if (!bit_equal(node_space[i].avail_bitmap,
-			       node_space[j].avail_bitmap)) {
+			       node_space[j].avail_bitmap) ||
+		    (!node_space[i].resv_bitmap !=
+		     !node_space[j].resv_bitmap) ||
+		    (node_space[i].resv_bitmap &&
+		     !bit_equal(node_space[i].resv_bitmap,
+				node_space[j].resv_bitmap))) {
 			i = j;
 			continue;
 		}
 		node_space[i].end_time = node_space[j].end_time;
 		node_space[i].next = node_space[j].next;
 		FREE_NULL_BITMAP(node_space[j].avail_bitmap);
+		FREE_NULL_BITMAP(node_space[j].resv_bitmap);
 		break;
 	}
 }
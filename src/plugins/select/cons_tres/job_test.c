@@ -41,6 +41,9 @@
 
 #define _DEBUG 0	/* Enables module specific debugging */
 
+/* Maximum number of preemptees _preempt_prune() tries to spare per job */
+#define PREEMPT_PRUNE_MAX 32
+
 /*
  * These symbols are defined here so when we link with something other
  * than the slurmctld we will have these symbols defined. They will get
@@ -77,12 +80,35 @@ typedef struct node_weight_struct {
 	uint32_t weight;	/* priority of node for scheduling work on */
 } node_weight_type;
 
+/*
+ * Every node grouped by weight, in order of increasing weight. Node weights
+ * only change on reconfiguration or node update, so this is built once and
+ * reused by _build_node_weight_list() for each job test.
+ */
+static node_weight_type *node_weight_cache = NULL;
+static int node_weight_cache_cnt = -1;	/* -1 if cache must be rebuilt */
+static pthread_mutex_t node_weight_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 typedef struct topo_weight_info {
 	bitstr_t *node_bitmap;
 	int node_cnt;
 	uint64_t weight;
 } topo_weight_info_t;
 
+typedef struct best_fit_node {	/* Candidate node for CR_BEST_FIT */
+	int node_inx;		/* Index into node_record_table_ptr */
+	bool idle;		/* Node has no jobs allocated to it */
+	uint16_t avail_cpus;	/* Count of available CPUs */
+	uint32_t leaf_idle_cnt;	/* Idle nodes on this node's leaf switch */
+	bool leaf_idle;		/* All nodes on this node's leaf switch idle */
+} best_fit_node_t;
+
+typedef struct preempt_cost {	/* Preemption candidate for _preempt_prune */
+	struct job_record *job_ptr;
+	uint64_t cost;		/* From preempt_job_cost() */
+	bool spared;		/* Job is not to be preempted */
+} preempt_cost_t;
+
 /* Local functions */
 static void _block_whole_nodes(bitstr_t *node_bitmap,
 			       bitstr_t **orig_core_bitmap,
@@ -108,6 +134,13 @@ static int _eval_nodes(struct job_record *job_ptr, gres_mc_data_t *mc_ptr,
 		       uint32_t req_nodes, avail_res_t **avail_res_array,
 		       uint16_t cr_type, bool prefer_alloc_nodes,
 		       bool first_pass);
+static int _eval_nodes_best_fit(struct job_record *job_ptr,
+				gres_mc_data_t *mc_ptr, bitstr_t *node_map,
+				bitstr_t **avail_core, uint32_t min_nodes,
+				uint32_t max_nodes, uint32_t req_nodes,
+				avail_res_t **avail_res_array,
+				uint16_t cr_type, bool prefer_alloc_nodes,
+				bool first_pass);
 static int _eval_nodes_busy(struct job_record *job_ptr,
 			    gres_mc_data_t *mc_ptr, bitstr_t *node_map,
 			    bitstr_t **avail_core, uint32_t min_nodes,
@@ -165,9 +198,8 @@ static int _job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		     bool qos_preemptor, bool preempt_mode);
 static inline void _log_select_maps(char *loc, bitstr_t *node_map,
 				    bitstr_t **core_map);
-static int _node_weight_find(void *x, void *key);
 static void _node_weight_free(void *x);
-static int _node_weight_sort(void *x, void *y);
+static int _node_weight_sort(const void *x, const void *y);
 static void _rm_job_res(job_resources_t *job_resrcs_ptr,
 			bitstr_t ***sys_resrcs_ptr);
 static avail_res_t **_select_nodes(struct job_record *job_ptr,
@@ -188,30 +220,100 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 			      enum node_cr_state job_node_req,
 			      bitstr_t **exc_cores, bool qos_preemptor);
 
-/* Find node_weight_type element from list with same weight as node config */
-static int _node_weight_find(void *x, void *key)
+/* Free node_weight_type element from list */
+static void _node_weight_free(void *x)
 {
 	node_weight_type *nwt = (node_weight_type *) x;
-	struct config_record *config_ptr = (struct config_record *) key;
-	if (nwt->weight == config_ptr->weight)
+	bit_free(nwt->node_bitmap);
+	xfree(nwt);
+}
+
+/* Sort array of node_weight_type records in order of increasing weight */
+static int _node_weight_sort(const void *x, const void *y)
+{
+	const node_weight_type *nwt1 = x;
+	const node_weight_type *nwt2 = y;
+
+	if (nwt1->weight < nwt2->weight)
+		return -1;
+	if (nwt1->weight > nwt2->weight)
 		return 1;
 	return 0;
 }
 
-/* Free node_weight_type element from list */
-static void _node_weight_free(void *x)
+/* Group every node by weight. Call with node_weight_cache_mutex locked. */
+static void _build_node_weight_cache(void)
 {
-	node_weight_type *nwt = (node_weight_type *) x;
-	bit_free(nwt->node_bitmap);
-	xfree(nwt);
+	int i, j;
+	struct node_record *node_ptr;
+
+	node_weight_cache_cnt = 0;
+	for (i = 0, node_ptr = node_record_table_ptr; i < select_node_cnt;
+	     i++, node_ptr++) {
+		for (j = 0; j < node_weight_cache_cnt; j++) {
+			if (node_weight_cache[j].weight ==
+			    node_ptr->config_ptr->weight)
+				break;
+		}
+		if (j >= node_weight_cache_cnt) {
+			xrealloc(node_weight_cache, sizeof(node_weight_type) *
+				 (node_weight_cache_cnt + 1));
+			node_weight_cache[j].node_bitmap =
+				bit_alloc(select_node_cnt);
+			node_weight_cache[j].weight =
+				node_ptr->config_ptr->weight;
+			node_weight_cache_cnt++;
+		}
+		bit_set(node_weight_cache[j].node_bitmap, i);
+	}
+	if (node_weight_cache_cnt > 1) {
+		qsort(node_weight_cache, node_weight_cache_cnt,
+		      sizeof(node_weight_type), _node_weight_sort);
+	}
 }
 
-/* Sort list of node_weight_type reords in order of increasing node weight */
-static int _node_weight_sort(void *x, void *y)
+/*
+ * Discard the cached node weight groups. Call when node weights or the node
+ * table may have changed.
+ */
+extern void node_weight_cache_clear(void)
 {
-	node_weight_type *nwt1 = *(node_weight_type **) x;
-	node_weight_type *nwt2 = *(node_weight_type **) y;
-	return (int) (nwt1->weight - nwt2->weight);
+	int i;
+
+	slurm_mutex_lock(&node_weight_cache_mutex);
+	for (i = 0; i < node_weight_cache_cnt; i++)
+		FREE_NULL_BITMAP(node_weight_cache[i].node_bitmap);
+	xfree(node_weight_cache);
+	node_weight_cache_cnt = -1;
+	slurm_mutex_unlock(&node_weight_cache_mutex);
+}
+
+/*
+ * Discard the cached node weight groups if the weight of the given node no
+ * longer matches its group
+ */
+extern void node_weight_cache_update(int node_inx)
+{
+	struct node_record *node_ptr = node_record_table_ptr + node_inx;
+	bool stale = true;
+	int i;
+
+	slurm_mutex_lock(&node_weight_cache_mutex);
+	if (node_weight_cache_cnt < 0) {
+		slurm_mutex_unlock(&node_weight_cache_mutex);
+		return;
+	}
+	for (i = 0; i < node_weight_cache_cnt; i++) {
+		if (!bit_test(node_weight_cache[i].node_bitmap, node_inx))
+			continue;
+		if (node_weight_cache[i].weight == node_ptr->config_ptr->weight)
+			stale = false;
+		break;
+	}
+	slurm_mutex_unlock(&node_weight_cache_mutex);
+
+	if (stale)
+		node_weight_cache_clear();
 }
 
 /*
@@ -220,35 +322,29 @@ static int _node_weight_sort(void *x, void *y)
  */
 static List _build_node_weight_list(bitstr_t *node_bitmap)
 {
-	int i, i_first, i_last;
+	int i;
 	List node_list;
-	struct node_record *node_ptr;
 	node_weight_type *nwt;
 
 	xassert(node_bitmap);
 	/* Build list of node_weight_type records, one per node weight */
 	node_list = list_create(_node_weight_free);
-	i_first = bit_ffs(node_bitmap);
-	if (i_first == -1)
+	if (bit_ffs(node_bitmap) == -1)
 		return node_list;
-	i_last = bit_fls(node_bitmap);
-	for (i = i_first; i <= i_last; i++) {
-		if (!bit_test(node_bitmap, i))
+
+	slurm_mutex_lock(&node_weight_cache_mutex);
+	if (node_weight_cache_cnt < 0)
+		_build_node_weight_cache();
+	for (i = 0; i < node_weight_cache_cnt; i++) {
+		if (!bit_overlap(node_weight_cache[i].node_bitmap, node_bitmap))
 			continue;
-		node_ptr = node_record_table_ptr + i;
-		nwt = list_find_first(node_list, _node_weight_find,
-				      node_ptr->config_ptr);
-		if (!nwt) {
-			nwt = xmalloc(sizeof(node_weight_type));
-			nwt->node_bitmap = bit_alloc(select_node_cnt);
-			nwt->weight = node_ptr->config_ptr->weight;
-			list_append(node_list, nwt);
-		}
-		bit_set(nwt->node_bitmap, i);
+		nwt = xmalloc(sizeof(node_weight_type));
+		nwt->node_bitmap = bit_copy(node_weight_cache[i].node_bitmap);
+		bit_and(nwt->node_bitmap, node_bitmap);
+		nwt->weight = node_weight_cache[i].weight;
+		list_append(node_list, nwt);
 	}
-
-	/* Sort the list in order of increasing node weight */
-	list_sort(node_list, _node_weight_sort);
+	slurm_mutex_unlock(&node_weight_cache_mutex);
 
 	return node_list;
 }
@@ -2394,6 +2490,18 @@ static int _eval_nodes(struct job_record *job_ptr, gres_mc_data_t *mc_ptr,
 		}
 	}
 
+	if ((cr_type & CR_BEST_FIT) && !details_ptr->contiguous) {
+		/*
+		 * Select resources so as to keep whole nodes and whole leaf
+		 * switches free for large jobs
+		 */
+		return _eval_nodes_best_fit(job_ptr, mc_ptr, node_map,
+					    avail_core, min_nodes, max_nodes,
+					    req_nodes, avail_res_array,
+					    cr_type, prefer_alloc_nodes,
+					    first_pass);
+	}
+
 	if (job_ptr->gres_list && (job_ptr->bit_flags & GRES_ENFORCE_BIND))
 		enforce_binding = true;
 
@@ -3349,6 +3457,285 @@ fini:	bit_free(orig_node_map);
 	return error_code;
 }
 
+/*
+ * Order best-fit candidates: partially allocated nodes with the fewest
+ * available CPUs first, then idle nodes on the leaf switches with the fewest
+ * idle nodes, with nodes on entirely idle leaf switches used last.
+ */
+static int _best_fit_sort(const void *x, const void *y)
+{
+	const best_fit_node_t *n1 = x;
+	const best_fit_node_t *n2 = y;
+
+	if (n1->idle != n2->idle)
+		return n1->idle ? 1 : -1;
+	if (n1->leaf_idle != n2->leaf_idle)
+		return n1->leaf_idle ? 1 : -1;
+	if (!n1->idle && (n1->avail_cpus != n2->avail_cpus))
+		return (n1->avail_cpus < n2->avail_cpus) ? -1 : 1;
+	if (n1->leaf_idle_cnt != n2->leaf_idle_cnt)
+		return (n1->leaf_idle_cnt < n2->leaf_idle_cnt) ? -1 : 1;
+	return (n1->node_inx - n2->node_inx);
+}
+
+/*
+ * Select resources so as to minimize resource fragmentation (CR_BEST_FIT).
+ * Within each node weight, use the partially allocated nodes with the least
+ * free capacity before any idle node, then take idle nodes from the leaf
+ * switches which are already in use, so whole nodes and whole leaf switches
+ * remain available for large jobs.
+ */
+static int _eval_nodes_best_fit(struct job_record *job_ptr,
+				gres_mc_data_t *mc_ptr, bitstr_t *node_map,
+				bitstr_t **avail_core, uint32_t min_nodes,
+				uint32_t max_nodes, uint32_t req_nodes,
+				avail_res_t **avail_res_array,
+				uint16_t cr_type, bool prefer_alloc_nodes,
+				bool first_pass)
+{
+	int i, j, i_start, i_end, error_code = SLURM_ERROR;
+	int rem_cpus, rem_nodes; /* remaining resources desired */
+	int min_rem_nodes;	/* remaining resources desired */
+	int total_cpus = 0;	/* #CPUs allocated to job */
+	int64_t rem_max_cpus;
+	struct job_details *details_ptr = job_ptr->details;
+	bitstr_t *req_map = details_ptr->req_node_bitmap;
+	bitstr_t *orig_node_map = bit_copy(node_map);
+	bool all_done = false, gres_per_job;
+	uint16_t avail_cpus = 0, min_gres_cpu;
+	uint32_t sockets_per_node = 1;
+	uint32_t *leaf_idle_cnt = NULL;
+	bool *leaf_idle = NULL;
+	struct node_record *node_ptr;
+	List node_weight_list = NULL;
+	node_weight_type *nwt;
+	ListIterator iter;
+	best_fit_node_t *cand = NULL;
+	int cand_cnt;
+	bool enforce_binding = false;
+
+	if (job_ptr->gres_list && (job_ptr->bit_flags & GRES_ENFORCE_BIND))
+		enforce_binding = true;
+	rem_cpus = details_ptr->min_cpus;
+	rem_max_cpus = details_ptr->max_cpus;
+	min_rem_nodes = min_nodes;
+	if ((details_ptr->num_tasks != NO_VAL) &&
+	    (details_ptr->num_tasks != 0))
+		max_nodes = MIN(max_nodes, details_ptr->num_tasks);
+	if ((gres_per_job = gres_plugin_job_sched_init(job_ptr->gres_list)))
+		rem_nodes = MIN(min_nodes, req_nodes);
+	else
+		rem_nodes = MAX(min_nodes, req_nodes);
+	if (job_ptr->details->mc_ptr &&
+	    job_ptr->details->mc_ptr->sockets_per_node)
+		sockets_per_node = job_ptr->details->mc_ptr->sockets_per_node;
+	min_gres_cpu = gres_plugin_job_min_cpu_node(sockets_per_node,
+					job_ptr->details->ntasks_per_node,
+					job_ptr->gres_list);
+
+	i_start = bit_ffs(node_map);
+	if (i_start >= 0)
+		i_end = bit_fls(node_map);
+	else
+		i_end = i_start - 1;
+	if (req_map) {
+		for (i = i_start; i <= i_end; i++) {
+			if (!bit_test(req_map, i)) {
+				bit_clear(node_map, i);
+				continue;
+			}
+			node_ptr = node_record_table_ptr + i;
+			if (!bit_test(node_map, i)) {
+				debug("%pJ required node %s not available",
+				      job_ptr, node_ptr->name);
+				continue;
+			}
+			if (!avail_res_array[i] ||
+			    !avail_res_array[i]->avail_cpus) {
+				debug("%pJ required node %s lacks available resources",
+				      job_ptr, node_ptr->name);
+				goto fini;
+			}
+			_select_cores(job_ptr, mc_ptr, enforce_binding, i,
+				      &avail_cpus, max_nodes, min_rem_nodes,
+				      avail_core, avail_res_array, first_pass);
+			_cpus_to_use(&avail_cpus, rem_max_cpus, min_rem_nodes,
+				     details_ptr, avail_res_array[i], i,
+				     cr_type, min_gres_cpu);
+			if ((avail_cpus > 0) && (max_nodes > 0)) {
+				total_cpus += avail_cpus;
+				rem_cpus   -= avail_cpus;
+				rem_max_cpus -= avail_cpus;
+				rem_nodes--;
+				min_rem_nodes--;
+				/* leaving bitmap set, decr max limit */
+				if (max_nodes)
+					max_nodes--;
+				if (gres_per_job) {
+					gres_plugin_job_sched_add(
+						job_ptr->gres_list,
+						avail_res_array[i]->
+						sock_gres_list, avail_cpus);
+				}
+			} else {	/* node not selected (yet) */
+				debug("%pJ required node %s lacks available resources",
+				      job_ptr, node_ptr->name);
+				goto fini;
+			}
+		}
+		if ((rem_nodes <= 0) && (rem_cpus <= 0) &&
+		    gres_plugin_job_sched_test(job_ptr->gres_list,
+					       job_ptr->job_id)) {
+			error_code = SLURM_SUCCESS;
+			bit_and(node_map, req_map);
+			goto fini;
+		}
+		if (max_nodes <= 0) {
+			error_code = SLURM_ERROR;
+			goto fini;
+		}
+		bit_and_not(orig_node_map, node_map);
+	} else {
+		bit_clear_all(node_map);
+	}
+
+	/* Compute CPUs already allocated to required nodes */
+	if ((details_ptr->max_cpus != NO_VAL) &&
+	    (total_cpus > details_ptr->max_cpus)) {
+		info("%pJ can't use required nodes due to max CPU limit",
+		     job_ptr);
+		goto fini;
+	}
+
+	/* Count the idle nodes on each leaf switch used by candidate nodes */
+	if (switch_record_cnt && switch_record_table && (i_start >= 0)) {
+		leaf_idle_cnt = xmalloc(sizeof(uint32_t) * (i_end + 1));
+		leaf_idle = xmalloc(sizeof(bool) * (i_end + 1));
+		for (j = 0; j < switch_record_cnt; j++) {
+			uint32_t idle_cnt, node_cnt;
+			int first, last;
+			if (switch_record_table[j].level != 0)
+				continue;
+			if (!bit_overlap(switch_record_table[j].node_bitmap,
+					 orig_node_map))
+				continue;
+			idle_cnt = bit_overlap(switch_record_table[j].
+					       node_bitmap, idle_node_bitmap);
+			node_cnt = bit_set_count(switch_record_table[j].
+						 node_bitmap);
+			first = MAX(bit_ffs(switch_record_table[j].
+					    node_bitmap), i_start);
+			last = MIN(bit_fls(switch_record_table[j].
+					   node_bitmap), i_end);
+			for (i = first; i <= last; i++) {
+				if (!bit_test(switch_record_table[j].
+					      node_bitmap, i))
+					continue;
+				leaf_idle_cnt[i] = idle_cnt;
+				leaf_idle[i] = (idle_cnt == node_cnt);
+			}
+		}
+	}
+
+	if (max_nodes == 0)
+		all_done = true;
+	if (i_start >= 0)
+		cand = xmalloc(sizeof(best_fit_node_t) * (i_end - i_start + 1));
+	node_weight_list = _build_node_weight_list(orig_node_map);
+	iter = list_iterator_create(node_weight_list);
+	while (!all_done && (nwt = (node_weight_type *) list_next(iter))) {
+		cand_cnt = 0;
+		for (i = i_start; i <= i_end; i++) {
+			if (!avail_res_array[i] ||
+			    !avail_res_array[i]->avail_cpus)
+				continue;
+			/* Node not available or already selected */
+			if (!bit_test(nwt->node_bitmap, i) ||
+			    bit_test(node_map, i))
+				continue;
+			cand[cand_cnt].node_inx = i;
+			cand[cand_cnt].idle = bit_test(idle_node_bitmap, i);
+			cand[cand_cnt].avail_cpus =
+				avail_res_array[i]->avail_cpus;
+			if (leaf_idle_cnt) {
+				cand[cand_cnt].leaf_idle_cnt = leaf_idle_cnt[i];
+				cand[cand_cnt].leaf_idle = leaf_idle[i];
+			} else {
+				cand[cand_cnt].leaf_idle_cnt = 0;
+				cand[cand_cnt].leaf_idle = false;
+			}
+			cand_cnt++;
+		}
+		if (cand_cnt > 1)
+			qsort(cand, cand_cnt, sizeof(best_fit_node_t),
+			      _best_fit_sort);
+		for (j = 0; j < cand_cnt; j++) {
+			i = cand[j].node_inx;
+			/* The last node must satisfy all remaining CPUs */
+			if ((max_nodes == 1) &&
+			    (avail_res_array[i]->avail_cpus < rem_cpus))
+				continue;
+			_select_cores(job_ptr, mc_ptr, enforce_binding, i,
+				      &avail_cpus, max_nodes, min_rem_nodes,
+				      avail_core, avail_res_array, first_pass);
+			_cpus_to_use(&avail_cpus, rem_max_cpus, min_rem_nodes,
+				     details_ptr, avail_res_array[i], i,
+				     cr_type, min_gres_cpu);
+			if (avail_cpus == 0)
+				continue;
+			total_cpus += avail_cpus;
+			if ((details_ptr->max_cpus != NO_VAL) &&
+			    (total_cpus > details_ptr->max_cpus)) {
+				debug2("%s: %s: %pJ can't use node %d without exceeding job limit",
+				       plugin_type, __func__, job_ptr, i);
+				total_cpus -= avail_cpus;
+				continue;
+			}
+			rem_cpus -= avail_cpus;
+			rem_max_cpus -= avail_cpus;
+			rem_nodes--;
+			min_rem_nodes--;
+			max_nodes--;
+			bit_set(node_map, i);
+			if (gres_per_job) {
+				gres_plugin_job_sched_add(job_ptr->gres_list,
+					avail_res_array[i]->sock_gres_list,
+					avail_cpus);
+			}
+			if ((rem_nodes <= 0) && (rem_cpus <= 0) &&
+			    gres_plugin_job_sched_test(job_ptr->gres_list,
+						       job_ptr->job_id)) {
+				error_code = SLURM_SUCCESS;
+				all_done = true;
+				break;
+			}
+			if (max_nodes == 0) {
+				all_done = true;
+				break;
+			}
+		}
+	}
+	list_iterator_destroy(iter);
+
+	if (error_code == SLURM_SUCCESS) {
+		/* Already succeeded */
+	} else if ((rem_cpus > 0) || (min_rem_nodes > 0) ||
+		   !gres_plugin_job_sched_test(job_ptr->gres_list,
+					       job_ptr->job_id)) {
+		bit_clear_all(node_map);
+		error_code = SLURM_ERROR;
+	} else {
+		error_code = SLURM_SUCCESS;
+	}
+
+fini:	FREE_NULL_LIST(node_weight_list);
+	xfree(cand);
+	xfree(leaf_idle);
+	xfree(leaf_idle_cnt);
+	bit_free(orig_node_map);
+	return error_code;
+}
+
 static int _topo_weight_find(void *x, void *key)
 {
 	topo_weight_info_t *nw = (topo_weight_info_t *) x;
@@ -6353,6 +6740,146 @@ clear_bit:	/* This node is not usable by this job */
 	return SLURM_SUCCESS;
 }
 
+/* Return true if the job's resources are released when it is preempted */
+static bool _preempt_removable(struct job_record *job_ptr)
+{
+	uint16_t mode;
+
+	if (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr))
+		return false;
+	mode = slurm_job_preempt_mode(job_ptr);
+	if ((mode != PREEMPT_MODE_REQUEUE)    &&
+	    (mode != PREEMPT_MODE_CHECKPOINT) &&
+	    (mode != PREEMPT_MODE_CANCEL))
+		return false;
+	return true;
+}
+
+/* qsort function: sort preemption candidates by decreasing cost */
+static int _sort_preempt_cost_dec(const void *x, const void *y)
+{
+	const preempt_cost_t *cand1 = (const preempt_cost_t *) x;
+	const preempt_cost_t *cand2 = (const preempt_cost_t *) y;
+
+	if (cand1->cost > cand2->cost)
+		return -1;
+	if (cand1->cost < cand2->cost)
+		return 1;
+	return 0;
+}
+
+/*
+ * The job can start once every preemptable job in preemptee_candidates has
+ * been removed, using the nodes in node_bitmap. Try keeping the most costly
+ * of the jobs which would be preempted, one at a time. A job is spared if the
+ * job can still start and the total cost of the jobs preempted drops. Spared
+ * jobs are removed from preemptee_candidates and node_bitmap is updated to
+ * the nodes selected with the remaining candidates removed.
+ */
+static void _preempt_prune(struct job_record *job_ptr, bitstr_t *node_bitmap,
+			   bitstr_t *orig_node_map, uint32_t min_nodes,
+			   uint32_t max_nodes, uint32_t req_nodes,
+			   uint16_t cr_type, uint16_t job_node_req,
+			   bitstr_t **exc_cores, List preemptee_candidates)
+{
+	preempt_cost_t *cand;
+	struct job_record *tmp_job_ptr;
+	struct part_res_record *future_part;
+	struct node_use_record *future_usage;
+	ListIterator job_iterator;
+	bitstr_t *best_map;
+	uint64_t best_cost = 0, cost;
+	time_t now = time(NULL);
+	int cand_cnt = 0, preempt_cnt = 0, spared_cnt = 0, test_cnt = 0;
+	int i, j, rc;
+
+	job_ptr->details->preempt_spared = 0;
+	cand = xmalloc(sizeof(preempt_cost_t) *
+		       (list_count(preemptee_candidates) + 1));
+	job_iterator = list_iterator_create(preemptee_candidates);
+	while ((tmp_job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (!_preempt_removable(tmp_job_ptr))
+			continue;
+		cand[cand_cnt].job_ptr = tmp_job_ptr;
+		cand[cand_cnt].cost = preempt_job_cost(tmp_job_ptr, now);
+		if (tmp_job_ptr->node_bitmap &&
+		    bit_overlap(node_bitmap, tmp_job_ptr->node_bitmap)) {
+			best_cost += cand[cand_cnt].cost;
+			preempt_cnt++;
+		}
+		cand_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+	if (preempt_cnt <= 1) {
+		xfree(cand);
+		return;
+	}
+	qsort(cand, cand_cnt, sizeof(preempt_cost_t), _sort_preempt_cost_dec);
+
+	best_map = bit_copy(node_bitmap);
+	for (i = 0; (i < cand_cnt) && (test_cnt < PREEMPT_PRUNE_MAX); i++) {
+		if (!cand[i].job_ptr->node_bitmap ||
+		    !bit_overlap(best_map, cand[i].job_ptr->node_bitmap))
+			continue;	/* Not preempted now */
+		test_cnt++;
+		future_part = _dup_part_data(select_part_record);
+		future_usage = _dup_node_usage(select_node_usage);
+		if (!future_part || !future_usage) {
+			cr_destroy_part_data(future_part);
+			cr_destroy_node_data(future_usage, NULL);
+			break;
+		}
+		cand[i].spared = true;
+		for (j = 0; j < cand_cnt; j++) {
+			if (!cand[j].spared) {
+				(void) rm_job_res(future_part, future_usage,
+						  cand[j].job_ptr, 0);
+			}
+		}
+		bit_or(node_bitmap, orig_node_map);
+		rc = _job_test(job_ptr, node_bitmap, min_nodes, max_nodes,
+			       req_nodes, SELECT_MODE_WILL_RUN, cr_type,
+			       job_node_req, future_part, future_usage,
+			       exc_cores, false, false, true);
+		cr_destroy_part_data(future_part);
+		cr_destroy_node_data(future_usage, NULL);
+
+		cost = 0;
+		for (j = 0; (rc == SLURM_SUCCESS) && (j < cand_cnt); j++) {
+			if (!cand[j].spared && cand[j].job_ptr->node_bitmap &&
+			    bit_overlap(node_bitmap,
+					cand[j].job_ptr->node_bitmap))
+				cost += cand[j].cost;
+		}
+		if ((rc == SLURM_SUCCESS) && (cost < best_cost)) {
+			best_cost = cost;
+			bit_copybits(best_map, node_bitmap);
+			spared_cnt++;
+		} else {
+			cand[i].spared = false;
+		}
+	}
+	bit_copybits(node_bitmap, best_map);
+	FREE_NULL_BITMAP(best_map);
+
+	if (spared_cnt) {
+		for (i = 0; i < cand_cnt; i++) {
+			if (!cand[i].spared)
+				continue;
+			list_delete_all(preemptee_candidates, _find_job,
+					cand[i].job_ptr);
+		}
+		/* Counted by select_nodes() when the preemptees are signaled */
+		job_ptr->details->preempt_spared = spared_cnt;
+		if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
+			info("%s: %s: %pJ spared %d of %d preemptees",
+			     plugin_type, __func__, job_ptr, spared_cnt,
+			     preempt_cnt);
+		}
+	}
+	xfree(cand);
+}
+
 /* Allocate resources for a job now, if possible */
 extern int run_now(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		   uint32_t min_nodes, uint32_t max_nodes,
@@ -6512,6 +7039,11 @@ top:	orig_node_map = bit_copy(save_node_map);
 
 		if ((rc == SLURM_SUCCESS) && preemptee_job_list &&
 		    preemptee_candidates) {
+			/* Spare any preemptees not actually required */
+			_preempt_prune(job_ptr, node_bitmap, orig_node_map,
+				       min_nodes, max_nodes, req_nodes,
+				       tmp_cr_type, job_node_req, exc_cores,
+				       preemptee_candidates);
 			/*
 			 * Build list of preemptee jobs whose resources are
 			 * actually used
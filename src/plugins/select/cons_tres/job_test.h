@@ -163,6 +163,18 @@ extern void log_tres_state(struct node_use_record *node_usage,
  */
 extern bitstr_t **mark_avail_cores(bitstr_t *node_bitmap, uint16_t core_spec);
 
+/*
+ * Discard the cached grouping of nodes by weight. Call when node weights or
+ * the node table may have changed.
+ */
+extern void node_weight_cache_clear(void);
+
+/*
+ * Discard the cached grouping of nodes by weight if the given node's weight
+ * has changed
+ */
+extern void node_weight_cache_update(int node_inx);
+
 /*
  * deallocate resources previously allocated to the given job
  * - subtract 'struct job_resources' resources from 'struct part_res_record'
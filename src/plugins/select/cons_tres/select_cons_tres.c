@@ -949,6 +949,7 @@ extern int fini(void)
 	select_part_record = NULL;
 	free_core_array(&spec_core_res);
 	cr_fini_global_core_data();
+	node_weight_cache_clear();
 
 	return SLURM_SUCCESS;
 }
@@ -1010,6 +1011,7 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 		return SLURM_ERROR;
 	}
 
+	node_weight_cache_clear();
 	sched_params = slurm_get_sched_params();
 	if (sched_params && xstrcasestr(sched_params, "preempt_strict_order"))
 		preempt_strict_order = true;
@@ -2171,6 +2173,9 @@ extern int select_p_update_node_config(int index)
 		return SLURM_ERROR;
 	}
 
+	/* Node weight may have changed */
+	node_weight_cache_update(index);
+
 	/*
 	 * Socket and core count can be changed when KNL node reboots in a
 	 * different NUMA configuration
@@ -184,6 +184,33 @@ static int _print_stats(void)
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
 
+	printf("\nResource fragmentation stats\n");
+	printf("\tIdle nodes: %u\n", buf->frag_idle_nodes);
+	printf("\tMixed nodes: %u\n", buf->frag_mixed_nodes);
+	printf("\tIdle CPUs: %u\n", buf->frag_idle_cpus);
+	printf("\tIdle CPUs on mixed nodes: %u\n", buf->frag_mixed_idle_cpus);
+	if (buf->frag_idle_cpus > 0) {
+		printf("\tFragmentation: %u%%\n",
+		       (uint32_t) ((uint64_t) buf->frag_mixed_idle_cpus * 100 /
+				   buf->frag_idle_cpus));
+	}
+	if (buf->frag_leaf_switches > 0) {
+		printf("\tIdle leaf switches: %u of %u\n",
+		       buf->frag_idle_leaf_switches, buf->frag_leaf_switches);
+	}
+
+	printf("\nPreemption stats\n");
+	printf("\tPreemption events: %u\n", buf->preempt_events);
+	printf("\tJobs preempted: %u\n", buf->preempt_jobs);
+	if (buf->preempt_events > 0) {
+		printf("\tMean jobs preempted per event: %u\n",
+		       buf->preempt_jobs / buf->preempt_events);
+	}
+	printf("\tCPU hours of preempted run time: %"PRIu64"\n",
+	       buf->preempt_cpu_secs / 3600);
+	printf("\tJobs spared by preemption set selection: %u\n",
+	       buf->preempt_spared);
+
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
 
@@ -45,8 +45,10 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/common/node_select.h"
 #include "src/common/slurm_priority.h"
+#include "src/common/tres_vec.h"
 
 #define _DEBUG 0
+#define GRP_AVAIL_HASH_SIZE 1024
 
 enum {
 	ACCT_POLICY_ADD_SUBMIT,
@@ -55,6 +57,19 @@ enum {
 	ACCT_POLICY_JOB_FINI
 };
 
+/*
+ * Vectors held in grp_avail_t, each g_tres_count long.
+ * A job fits under the Grp limits of an association and all of its parents
+ * for TRES i when its request is below entry i of the vector.
+ */
+enum {
+	GRP_AVAIL_TRES_MINS_CUR,	/* 0 once GrpTRESMins is used up */
+	GRP_AVAIL_TRES_MINS,		/* GrpTRESMins with safe limits */
+	GRP_AVAIL_TRES,			/* GrpTRES */
+	GRP_AVAIL_TRES_RUN_MINS,	/* GrpTRESRunMins */
+	GRP_AVAIL_CNT
+};
+
 typedef enum {
 	TRES_USAGE_OKAY,
 	TRES_USAGE_CUR_EXCEEDS_LIMIT,
@@ -69,6 +84,45 @@ typedef struct pack_limits {
 	slurmdb_qos_rec_t *qos_ptr_2;
 } pack_limits_t;
 
+/*
+ * Submit and accrue count removals coalesced between
+ * acct_policy_submit_batch_begin() and acct_policy_submit_batch_end().
+ * Only the job record fields read by _set_qos_order() and
+ * _qos_adjust_limit_usage() are set in job.
+ */
+static struct {
+	int depth;
+	uint32_t job_cnt;
+	uint32_t accrue_cnt;
+	struct job_record job;
+} submit_batch;
+
+/*
+ * Room left under the Grp TRES limits of an association and all of its
+ * parents, hashed on the association ID. An entry is current while
+ * g_assoc_usage_gen is unchanged.
+ */
+typedef struct grp_avail {
+	slurmdb_assoc_rec_t *assoc_ptr;
+	uint64_t *avail;	/* GRP_AVAIL_CNT vectors, see GRP_AVAIL_* */
+	uint32_t gen;		/* g_assoc_usage_gen when avail was set */
+	uint32_t tres_cnt;	/* g_tres_count when avail was set */
+	struct grp_avail *next;
+} grp_avail_t;
+
+/* Serializes grp_avail_hash access under the assoc read lock */
+static pthread_mutex_t grp_avail_mutex = PTHREAD_MUTEX_INITIALIZER;
+static grp_avail_t *grp_avail_hash[GRP_AVAIL_HASH_SIZE];
+
+static void _remove_accrue_time_internal(slurmdb_assoc_rec_t *assoc_ptr,
+					 slurmdb_qos_rec_t *qos_ptr_1,
+					 slurmdb_used_limits_t *used_limits_a1,
+					 slurmdb_used_limits_t *used_limits_u1,
+					 slurmdb_qos_rec_t *qos_ptr_2,
+					 slurmdb_used_limits_t *used_limits_a2,
+					 slurmdb_used_limits_t *used_limits_u2,
+					 int cnt);
+
 static int _get_tres_state_reason(int tres_pos, int unk_reason)
 {
 	switch (tres_pos) {
@@ -516,12 +570,26 @@ static bool _valid_job_assoc(struct job_record *job_ptr)
 	return true;
 }
 
+/*
+ * Copy the TRES allocated to job_ptr into alloc_tres, leaving out
+ * TRES_ARRAY_ENERGY. tres_alloc_cnt for ENERGY is currently after the fact,
+ * so it is never added to the usage or you will get underflows when you
+ * remove it.
+ */
+static void _get_alloc_tres(struct job_record *job_ptr, uint64_t *alloc_tres)
+{
+	memcpy(alloc_tres, job_ptr->tres_alloc_cnt,
+	       sizeof(uint64_t) * slurmctld_tres_cnt);
+	alloc_tres[TRES_ARRAY_ENERGY] = 0;
+}
+
 static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 				    slurmdb_qos_rec_t *qos_ptr,
 				    uint64_t *used_tres_run_secs,
 				    uint32_t job_cnt)
 {
 	slurmdb_used_limits_t *used_limits = NULL, *used_limits_a = NULL;
+	uint64_t alloc_tres[slurmctld_tres_cnt];
 	int i;
 
 	if (!qos_ptr || !job_ptr->assoc_ptr)
@@ -572,22 +640,21 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 		break;
 	case ACCT_POLICY_JOB_BEGIN:
 		qos_ptr->usage->grp_used_jobs++;
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			/* tres_alloc_cnt for ENERGY is currently after the
-			 * fact, so don't add it here or you will get underflows
-			 * when you remove it.  If this ever changes this will
-			 * have to be moved to a new TRES ARRAY probably.
-			 */
+		_get_alloc_tres(job_ptr, alloc_tres);
+		tres_vec_add(used_limits->tres, alloc_tres,
+			     slurmctld_tres_cnt);
+		tres_vec_add(used_limits_a->tres, alloc_tres,
+			     slurmctld_tres_cnt);
+		tres_vec_add(qos_ptr->usage->grp_used_tres, alloc_tres,
+			     slurmctld_tres_cnt);
+		tres_vec_add(qos_ptr->usage->grp_used_tres_run_secs,
+			     used_tres_run_secs, slurmctld_tres_cnt);
+
+		for (i = 0; i < slurmctld_tres_cnt; i++) {
+			if (get_log_level() < LOG_LEVEL_DEBUG2)
+				break;
 			if (i == TRES_ARRAY_ENERGY)
 				continue;
-
-			used_limits->tres[i] += job_ptr->tres_alloc_cnt[i];
-			used_limits_a->tres[i] += job_ptr->tres_alloc_cnt[i];
-
-			qos_ptr->usage->grp_used_tres[i] +=
-				job_ptr->tres_alloc_cnt[i];
-			qos_ptr->usage->grp_used_tres_run_secs[i] +=
-				used_tres_run_secs[i];
 			debug2("acct_policy_job_begin: after adding %pJ, qos %s grp_used_tres_run_secs(%s) is %"PRIu64,
 			       job_ptr, qos_ptr->name,
 			       assoc_mgr_tres_name_array[i],
@@ -612,43 +679,61 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 			       "underflow for qos %s", qos_ptr->name);
 		}
 
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			if (i == TRES_ARRAY_ENERGY)
-				continue;
-			if (job_ptr->tres_alloc_cnt[i] >
-			    qos_ptr->usage->grp_used_tres[i]) {
-				qos_ptr->usage->grp_used_tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "grp_used_tres(%s) "
-				       "underflow for QOS %s",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name);
-			} else
-				qos_ptr->usage->grp_used_tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
-
-			if (job_ptr->tres_alloc_cnt[i] > used_limits->tres[i]) {
-				used_limits->tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "used_limits->tres(%s) "
-				       "underflow for qos %s user %u",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name, used_limits->uid);
-			} else
-				used_limits->tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
-
-			if (job_ptr->tres_alloc_cnt[i] >
-			    used_limits_a->tres[i]) {
-				used_limits_a->tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "used_limits->tres(%s) "
-				       "underflow for qos %s account %s",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name, used_limits_a->acct);
-			} else
-				used_limits_a->tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
+		_get_alloc_tres(job_ptr, alloc_tres);
+		if (tres_vec_le(alloc_tres, qos_ptr->usage->grp_used_tres,
+				slurmctld_tres_cnt) &&
+		    tres_vec_le(alloc_tres, used_limits->tres,
+				slurmctld_tres_cnt) &&
+		    tres_vec_le(alloc_tres, used_limits_a->tres,
+				slurmctld_tres_cnt)) {
+			tres_vec_sub(qos_ptr->usage->grp_used_tres, alloc_tres,
+				     slurmctld_tres_cnt);
+			tres_vec_sub(used_limits->tres, alloc_tres,
+				     slurmctld_tres_cnt);
+			tres_vec_sub(used_limits_a->tres, alloc_tres,
+				     slurmctld_tres_cnt);
+		} else {
+			for (i = 0; i < slurmctld_tres_cnt; i++) {
+				if (i == TRES_ARRAY_ENERGY)
+					continue;
+				if (job_ptr->tres_alloc_cnt[i] >
+				    qos_ptr->usage->grp_used_tres[i]) {
+					qos_ptr->usage->grp_used_tres[i] = 0;
+					debug2("acct_policy_job_fini: "
+					       "grp_used_tres(%s) "
+					       "underflow for QOS %s",
+					       assoc_mgr_tres_name_array[i],
+					       qos_ptr->name);
+				} else
+					qos_ptr->usage->grp_used_tres[i] -=
+						job_ptr->tres_alloc_cnt[i];
+
+				if (job_ptr->tres_alloc_cnt[i] >
+				    used_limits->tres[i]) {
+					used_limits->tres[i] = 0;
+					debug2("acct_policy_job_fini: "
+					       "used_limits->tres(%s) "
+					       "underflow for qos %s user %u",
+					       assoc_mgr_tres_name_array[i],
+					       qos_ptr->name, used_limits->uid);
+				} else
+					used_limits->tres[i] -=
+						job_ptr->tres_alloc_cnt[i];
+
+				if (job_ptr->tres_alloc_cnt[i] >
+				    used_limits_a->tres[i]) {
+					used_limits_a->tres[i] = 0;
+					debug2("acct_policy_job_fini: "
+					       "used_limits->tres(%s) "
+					       "underflow for qos %s "
+					       "account %s",
+					       assoc_mgr_tres_name_array[i],
+					       qos_ptr->name,
+					       used_limits_a->acct);
+				} else
+					used_limits_a->tres[i] -=
+						job_ptr->tres_alloc_cnt[i];
+			}
 		}
 
 		if (used_limits->jobs)
@@ -681,12 +766,131 @@ static int _find_qos_part(void *x, void *key)
 	return 0;
 }
 
+/* Apply the submit and accrue count removals collected in submit_batch */
+static void _flush_submit_batch(void)
+{
+	slurmdb_assoc_rec_t *assoc_ptr;
+	slurmdb_qos_rec_t *qos_ptr_1, *qos_ptr_2;
+	slurmdb_used_limits_t *used_limits_a1 = NULL, *used_limits_u1 = NULL;
+	slurmdb_used_limits_t *used_limits_a2 = NULL, *used_limits_u2 = NULL;
+	uint32_t job_cnt = submit_batch.job_cnt;
+	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .qos = WRITE_LOCK };
+
+	if (!job_cnt)
+		return;
+
+	assoc_mgr_lock(&locks);
+
+	_set_qos_order(&submit_batch.job, &qos_ptr_1, &qos_ptr_2);
+	_qos_adjust_limit_usage(ACCT_POLICY_REM_SUBMIT, &submit_batch.job,
+				qos_ptr_1, NULL, job_cnt);
+	_qos_adjust_limit_usage(ACCT_POLICY_REM_SUBMIT, &submit_batch.job,
+				qos_ptr_2, NULL, job_cnt);
+
+	for (assoc_ptr = submit_batch.job.assoc_ptr; assoc_ptr;
+	     assoc_ptr = assoc_ptr->usage->parent_assoc_ptr) {
+		if (assoc_ptr->usage->used_submit_jobs >= job_cnt)
+			assoc_ptr->usage->used_submit_jobs -= job_cnt;
+		else {
+			assoc_ptr->usage->used_submit_jobs = 0;
+			debug2("acct_policy_remove_job_submit: "
+			       "used_submit_jobs underflow for "
+			       "account %s",
+			       assoc_ptr->acct);
+		}
+	}
+
+	if (submit_batch.accrue_cnt) {
+		assoc_ptr = submit_batch.job.assoc_ptr;
+		if (qos_ptr_1) {
+			used_limits_a1 = _get_acct_used_limits(
+				&qos_ptr_1->usage->acct_limit_list,
+				assoc_ptr->acct);
+			used_limits_u1 = _get_user_used_limits(
+				&qos_ptr_1->usage->user_limit_list,
+				submit_batch.job.user_id);
+		}
+		if (qos_ptr_2) {
+			used_limits_a2 = _get_acct_used_limits(
+				&qos_ptr_2->usage->acct_limit_list,
+				assoc_ptr->acct);
+			used_limits_u2 = _get_user_used_limits(
+				&qos_ptr_2->usage->user_limit_list,
+				submit_batch.job.user_id);
+		}
+		_remove_accrue_time_internal(assoc_ptr,
+					     qos_ptr_1,
+					     used_limits_a1,
+					     used_limits_u1,
+					     qos_ptr_2,
+					     used_limits_a2,
+					     used_limits_u2,
+					     submit_batch.accrue_cnt);
+	}
+
+	assoc_mgr_unlock(&locks);
+
+	submit_batch.job_cnt = 0;
+	submit_batch.accrue_cnt = 0;
+}
+
+/* Return true if PriorityFlags=ACCRUE_ALWAYS, so accrue counts are unused */
+static bool _accrue_always(void)
+{
+	static time_t sched_update = 0;
+	static uint16_t priority_flags = 0;
+
+	if (sched_update != slurmctld_conf.last_update) {
+		priority_flags = slurm_get_priority_flags();
+		sched_update = slurmctld_conf.last_update;
+	}
+
+	return (priority_flags & PRIORITY_FLAGS_ACCRUE_ALWAYS);
+}
+
+/*
+ * Add a job's submit count removal to submit_batch, first flushing the
+ * batch if the job counts against a different association or QOS.
+ */
+static void _batch_remove_submit(struct job_record *job_ptr, uint32_t job_cnt)
+{
+	struct job_details *details_ptr = job_ptr->details;
+	uint32_t accrue_cnt = 0;
+
+	if (!details_ptr || IS_JOB_PENDING(job_ptr)) {
+		acct_policy_handle_accrue_time(job_ptr, false);
+	} else if (details_ptr->accrue_time &&
+		   !(job_ptr->bit_flags & JOB_ACCRUE_OVER) &&
+		   !_accrue_always()) {
+		/*
+		 * The job stopped accruing. Batch the accrue count removal
+		 * acct_policy_handle_accrue_time() would otherwise make.
+		 */
+		job_ptr->bit_flags |= JOB_ACCRUE_OVER;
+		accrue_cnt = job_cnt;
+	}
+
+	if (submit_batch.job_cnt &&
+	    ((submit_batch.job.assoc_ptr != job_ptr->assoc_ptr) ||
+	     (submit_batch.job.qos_ptr != job_ptr->qos_ptr) ||
+	     (submit_batch.job.part_ptr != job_ptr->part_ptr)))
+		_flush_submit_batch();
+
+	submit_batch.job.assoc_ptr = job_ptr->assoc_ptr;
+	submit_batch.job.qos_ptr = job_ptr->qos_ptr;
+	submit_batch.job.part_ptr = job_ptr->part_ptr;
+	submit_batch.job.user_id = job_ptr->user_id;
+	submit_batch.job_cnt += job_cnt;
+	submit_batch.accrue_cnt += accrue_cnt;
+}
+
 static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 {
 	slurmdb_assoc_rec_t *assoc_ptr = NULL;
 	assoc_mgr_lock_t locks =
 		{ .assoc = WRITE_LOCK, .qos = WRITE_LOCK, .tres = READ_LOCK };
 	uint64_t used_tres_run_secs[slurmctld_tres_cnt];
+	uint64_t alloc_tres[slurmctld_tres_cnt];
 	int i;
 	uint32_t job_cnt = 1;
 
@@ -696,6 +900,10 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 	    || !_valid_job_assoc(job_ptr))
 		return;
 
+	if (((type == ACCT_POLICY_JOB_BEGIN) ||
+	     (type == ACCT_POLICY_JOB_FINI)) && job_ptr->tres_alloc_cnt)
+		_get_alloc_tres(job_ptr, alloc_tres);
+
 	if (type == ACCT_POLICY_JOB_FINI)
 		priority_g_job_end(job_ptr);
 	else if (type == ACCT_POLICY_JOB_BEGIN) {
@@ -711,6 +919,16 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 		   job_ptr->array_recs && job_ptr->array_recs->task_cnt)
 		job_cnt = job_ptr->array_recs->task_cnt;
 
+	/*
+	 * Jobs submitted to multiple partitions are removed from each
+	 * partition's QOS below, so they are never batched.
+	 */
+	if ((type == ACCT_POLICY_REM_SUBMIT) && submit_batch.depth &&
+	    !job_ptr->part_ptr_list) {
+		_batch_remove_submit(job_ptr, job_cnt);
+		return;
+	}
+
 	assoc_mgr_lock(&locks);
 
 	/*
@@ -836,14 +1054,16 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 			break;
 		case ACCT_POLICY_JOB_BEGIN:
 			assoc_ptr->usage->used_jobs++;
-			for (i=0; i<slurmctld_tres_cnt; i++) {
+			tres_vec_add(assoc_ptr->usage->grp_used_tres,
+				     alloc_tres, slurmctld_tres_cnt);
+			tres_vec_add(assoc_ptr->usage->grp_used_tres_run_secs,
+				     used_tres_run_secs, slurmctld_tres_cnt);
+
+			for (i = 0; i < slurmctld_tres_cnt; i++) {
+				if (get_log_level() < LOG_LEVEL_DEBUG2)
+					break;
 				if (i == TRES_ARRAY_ENERGY)
 					continue;
-
-				assoc_ptr->usage->grp_used_tres[i] +=
-					job_ptr->tres_alloc_cnt[i];
-				assoc_ptr->usage->grp_used_tres_run_secs[i] +=
-					used_tres_run_secs[i];
 				debug2("acct_policy_job_begin: after adding %pJ, assoc %u(%s/%s/%s) grp_used_tres_run_secs(%s) is %"PRIu64,
 				       job_ptr, assoc_ptr->id, assoc_ptr->acct,
 				       assoc_ptr->user, assoc_ptr->partition,
@@ -860,6 +1080,15 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 				       "underflow for account %s",
 				       assoc_ptr->acct);
 
+			if (job_ptr->tres_alloc_cnt &&
+			    tres_vec_le(alloc_tres,
+					assoc_ptr->usage->grp_used_tres,
+					slurmctld_tres_cnt)) {
+				tres_vec_sub(assoc_ptr->usage->grp_used_tres,
+					     alloc_tres, slurmctld_tres_cnt);
+				break;
+			}
+
 			for (i = 0; i < slurmctld_tres_cnt; i++) {
 				if (i == TRES_ARRAY_ENERGY)
 					continue;
@@ -888,6 +1117,8 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 		/* now handle all the group limits of the parents */
 		assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 	}
+	if ((type == ACCT_POLICY_JOB_BEGIN) || (type == ACCT_POLICY_JOB_FINI))
+		g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 }
 
@@ -1368,6 +1599,158 @@ static acct_policy_tres_usage_t _validate_tres_usage_limits_for_assoc(
 					   false);
 }
 
+/*
+ * _set_grp_avail - set grp_avail->avail to the smallest room left under the
+ * GrpTRESMins, GrpTRES and GrpTRESRunMins limits of the association and
+ * each of its parents, checked the same way as
+ * _validate_tres_usage_limits_for_assoc() does for one association.
+ */
+static void _set_grp_avail(grp_avail_t *grp_avail, uint32_t gen)
+{
+	slurmdb_assoc_rec_t *assoc_ptr;
+	uint64_t *avail, *avail_mins_cur, *avail_mins, *avail_tres,
+		*avail_run_mins;
+	uint64_t limit, run_mins, usage_mins;
+	int i;
+
+	if (!grp_avail->avail || (grp_avail->tres_cnt != g_tres_count)) {
+		xrealloc(grp_avail->avail,
+			 sizeof(uint64_t) * g_tres_count * GRP_AVAIL_CNT);
+		grp_avail->tres_cnt = g_tres_count;
+	}
+	avail = grp_avail->avail;
+	for (i = 0; i < (g_tres_count * GRP_AVAIL_CNT); i++)
+		avail[i] = INFINITE64;
+	avail_mins_cur = avail + (g_tres_count * GRP_AVAIL_TRES_MINS_CUR);
+	avail_mins = avail + (g_tres_count * GRP_AVAIL_TRES_MINS);
+	avail_tres = avail + (g_tres_count * GRP_AVAIL_TRES);
+	avail_run_mins = avail + (g_tres_count * GRP_AVAIL_TRES_RUN_MINS);
+
+	for (assoc_ptr = grp_avail->assoc_ptr; assoc_ptr;
+	     assoc_ptr = assoc_ptr->usage->parent_assoc_ptr) {
+		tres_vec_min_avail(avail_tres, assoc_ptr->grp_tres_ctld,
+				   assoc_ptr->usage->grp_used_tres,
+				   g_tres_count);
+		for (i = 0; i < g_tres_count; i++) {
+			run_mins = assoc_ptr->usage->grp_used_tres_run_secs[i] /
+				60;
+			usage_mins = (uint64_t)
+				(assoc_ptr->usage->usage_tres_raw[i] / 60);
+
+			limit = assoc_ptr->grp_tres_mins_ctld[i];
+			if ((limit != INFINITE64) && (usage_mins >= limit)) {
+				avail_mins_cur[i] = 0;
+				avail_mins[i] = 0;
+			} else if (limit != INFINITE64) {
+				avail_mins[i] = MIN(avail_mins[i],
+						    tres_avail(limit -
+							       usage_mins,
+							       run_mins));
+			}
+
+			limit = assoc_ptr->grp_tres_run_mins_ctld[i];
+			avail_run_mins[i] = MIN(avail_run_mins[i],
+						tres_avail(limit, run_mins));
+		}
+	}
+
+	grp_avail->gen = gen;
+}
+
+/* Find or add the grp_avail_hash entry of an association */
+static grp_avail_t *_find_grp_avail(slurmdb_assoc_rec_t *assoc_ptr)
+{
+	grp_avail_t *grp_avail;
+	int inx = assoc_ptr->id % GRP_AVAIL_HASH_SIZE;
+
+	/*
+	 * The address of a removed association may be reused, but removing
+	 * it changed g_assoc_usage_gen so the entry is set again when found.
+	 */
+	for (grp_avail = grp_avail_hash[inx]; grp_avail;
+	     grp_avail = grp_avail->next) {
+		if (grp_avail->assoc_ptr == assoc_ptr)
+			return grp_avail;
+	}
+
+	grp_avail = xmalloc(sizeof(grp_avail_t));
+	grp_avail->assoc_ptr = assoc_ptr;
+	grp_avail->next = grp_avail_hash[inx];
+	grp_avail_hash[inx] = grp_avail;
+
+	return grp_avail;
+}
+
+/*
+ * _grp_limits_fit - test whether a job fits under the Grp TRES limits of
+ * its association and all of its parents, skipping the limits a QOS or an
+ * admin has already set. A false return does not mean the job is over a
+ * limit, just that each association must be checked in turn to find out.
+ *
+ * IN - job_ptr - job to test, its assoc_ptr must be set
+ * IN - qos_rec - TRES limits the job's QOS have imposed already
+ * IN - tres_req_cnt - TRES requested by the job
+ * IN - job_tres_time_limit - TRES minutes requested by the job
+ * IN - safe_limits - if the safe flag was set on AccountingStorageEnforce
+ * NOTE: the assoc read lock must be set before calling this.
+ */
+static bool _grp_limits_fit(struct job_record *job_ptr,
+			    slurmdb_qos_rec_t *qos_rec,
+			    uint64_t *tres_req_cnt,
+			    uint64_t *job_tres_time_limit,
+			    bool safe_limits)
+{
+	grp_avail_t *grp_avail;
+	uint16_t *admin_set = job_ptr->limit_set.tres;
+	uint32_t gen = g_assoc_usage_gen;
+	uint64_t *avail, *avail_mins_cur, *avail_mins, *avail_tres,
+		*avail_run_mins;
+	bool admin, fit = true;
+	int i;
+
+	slurm_mutex_lock(&grp_avail_mutex);
+
+	grp_avail = _find_grp_avail(job_ptr->assoc_ptr);
+	if (!grp_avail->avail || (grp_avail->gen != gen) ||
+	    (grp_avail->tres_cnt != g_tres_count))
+		_set_grp_avail(grp_avail, gen);
+
+	avail = grp_avail->avail;
+	avail_mins_cur = avail + (g_tres_count * GRP_AVAIL_TRES_MINS_CUR);
+	avail_mins = avail + (g_tres_count * GRP_AVAIL_TRES_MINS);
+	avail_tres = avail + (g_tres_count * GRP_AVAIL_TRES);
+	avail_run_mins = avail + (g_tres_count * GRP_AVAIL_TRES_RUN_MINS);
+
+	for (i = 0; i < g_tres_count; i++) {
+		admin = (admin_set && (admin_set[i] == ADMIN_SET_LIMIT));
+
+		if (!admin && (qos_rec->grp_tres_mins_ctld[i] == INFINITE64)) {
+			if (safe_limits ?
+			    (job_tres_time_limit[i] >= avail_mins[i]) :
+			    !avail_mins_cur[i]) {
+				fit = false;
+				break;
+			}
+		}
+
+		if (!admin && (qos_rec->grp_tres_ctld[i] == INFINITE64) &&
+		    (tres_req_cnt[i] >= avail_tres[i])) {
+			fit = false;
+			break;
+		}
+
+		if ((qos_rec->grp_tres_run_mins_ctld[i] == INFINITE64) &&
+		    (job_tres_time_limit[i] >= avail_run_mins[i])) {
+			fit = false;
+			break;
+		}
+	}
+
+	slurm_mutex_unlock(&grp_avail_mutex);
+
+	return fit;
+}
+
 static int _qos_policy_validate(job_desc_msg_t *job_desc,
 				slurmdb_assoc_rec_t *assoc_ptr,
 				struct part_record *part_ptr,
@@ -2419,6 +2802,30 @@ extern void acct_policy_remove_job_submit(struct job_record *job_ptr)
 	_adjust_limit_usage(ACCT_POLICY_REM_SUBMIT, job_ptr);
 }
 
+/*
+ * acct_policy_submit_batch_begin - Start coalescing the submit count
+ *	removals of acct_policy_remove_job_submit() calls, as when the
+ *	tasks of a job array are cancelled one record at a time.
+ */
+extern void acct_policy_submit_batch_begin(void)
+{
+	submit_batch.depth++;
+}
+
+/*
+ * acct_policy_submit_batch_end - Apply the submit count removals coalesced
+ *	since acct_policy_submit_batch_begin().
+ */
+extern void acct_policy_submit_batch_end(void)
+{
+	xassert(submit_batch.depth > 0);
+
+	if (--submit_batch.depth)
+		return;
+
+	_flush_submit_batch();
+}
+
 /*
  * acct_policy_job_begin - Note that a job is starting for accounting
  *	policy purposes.
@@ -2504,6 +2911,7 @@ extern void acct_policy_alter_job(struct job_record *job_ptr,
 		/* now handle all the group limits of the parents */
 		assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 	}
+	g_assoc_usage_gen++;
 	assoc_mgr_unlock(&locks);
 }
 
@@ -3411,7 +3819,7 @@ extern bool acct_policy_job_runnable_post_select(
 	uint64_t job_tres_time_limit[slurmctld_tres_cnt];
 	uint32_t time_limit;
 	bool rc = true;
-	bool safe_limits = false;
+	bool safe_limits = false, grp_limits_fit = false;
 	int i, tres_pos = 0;
 	acct_policy_tres_usage_t tres_usage;
 	int parent = 0; /* flag to tell us if we are looking at the
@@ -3492,8 +3900,21 @@ extern bool acct_policy_job_runnable_post_select(
 						 job_tres_time_limit)))
 		goto end_it;
 
+	/*
+	 * If the job fits under the Grp limits of the whole association
+	 * chain only the association's own Max limits are left to check.
+	 */
+	if (job_ptr->assoc_ptr)
+		grp_limits_fit = _grp_limits_fit(job_ptr, &qos_rec,
+						 tres_req_cnt,
+						 job_tres_time_limit,
+						 safe_limits);
+
 	assoc_ptr = job_ptr->assoc_ptr;
 	while (assoc_ptr) {
+		if (grp_limits_fit)
+			goto max_limits;
+
 		for (i=0; i<slurmctld_tres_cnt; i++) {
 			tres_usage_mins[i] =
 				(uint64_t)(assoc_ptr->usage->usage_tres_raw[i]
@@ -3671,6 +4092,7 @@ extern bool acct_policy_job_runnable_post_select(
 			continue;
 		}
 
+max_limits:
 		if (!_validate_tres_limits_for_assoc(
 			    &tres_pos, job_tres_time_limit, 0,
 			    assoc_ptr->max_tres_mins_ctld,
@@ -3735,6 +4157,9 @@ extern bool acct_policy_job_runnable_post_select(
 
 		/* we don't need to check max_wall_pj here */
 
+		if (grp_limits_fit)
+			break;
+
 		assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 		parent = 1;
 	}
@@ -4530,3 +4955,21 @@ extern uint32_t acct_policy_get_prio_thresh(struct job_record *job_ptr,
 
 	return prio_thresh;
 }
+
+extern void acct_policy_fini(void)
+{
+	grp_avail_t *grp_avail, *next;
+	int i;
+
+	slurm_mutex_lock(&grp_avail_mutex);
+	for (i = 0; i < GRP_AVAIL_HASH_SIZE; i++) {
+		for (grp_avail = grp_avail_hash[i]; grp_avail;
+		     grp_avail = next) {
+			next = grp_avail->next;
+			xfree(grp_avail->avail);
+			xfree(grp_avail);
+		}
+		grp_avail_hash[i] = NULL;
+	}
+	slurm_mutex_unlock(&grp_avail_mutex);
+}
@@ -54,6 +54,20 @@ extern void acct_policy_add_job_submit(struct job_record *job_ptr);
  */
 extern void acct_policy_remove_job_submit(struct job_record *job_ptr);
 
+/*
+ * acct_policy_submit_batch_begin - Start coalescing the submit count
+ *	removals of acct_policy_remove_job_submit() calls into one update
+ *	per association and QOS. The job write lock must be held until
+ *	acct_policy_submit_batch_end() is called.
+ */
+extern void acct_policy_submit_batch_begin(void);
+
+/*
+ * acct_policy_submit_batch_end - Apply the submit count removals coalesced
+ *	since acct_policy_submit_batch_begin().
+ */
+extern void acct_policy_submit_batch_end(void);
+
 /*
  * acct_policy_job_begin - Note that a job is starting for accounting
  *	policy purposes.
@@ -174,4 +188,7 @@ extern void acct_policy_remove_accrue_time(struct job_record *job_ptr,
 extern uint32_t acct_policy_get_prio_thresh(struct job_record *job_ptr,
 					    bool assoc_mgr_locked);
 
+/* Free the association Grp TRES limit cache, called at shutdown */
+extern void acct_policy_fini(void);
+
 #endif /* !_HAVE_ACCT_POLICY_H */
@@ -853,6 +853,7 @@ int main(int argc, char **argv)
 	resv_fini();
 	trigger_fini();
 	fed_mgr_fini();
+	acct_policy_fini();
 	assoc_mgr_fini(1);
 	reserve_port_config(NULL);
 	free_rpc_stats();
@@ -2162,7 +2163,11 @@ static void *_slurmctld_background(void *no_data)
 			now = time(NULL);
 			last_trigger = now;
 			lock_slurmctld(job_node_read_lock);
-			trigger_process();
+			trigger_process(true);
+			unlock_slurmctld(job_node_read_lock);
+		} else if (trigger_event_pending(now)) {
+			lock_slurmctld(job_node_read_lock);
+			trigger_process(false);
 			unlock_slurmctld(job_node_read_lock);
 		}
 
@@ -89,14 +89,21 @@ struct gs_job {
 	struct job_record *job_ptr;
 	uint16_t sig_state;
 	uint16_t row_state;
+	uint32_t job_inx;	/* Index of this job in its part's job_list */
+	bool shadow_cast;	/* Shadow cast on lower priority partitions */
+	struct gs_job *job_next; /* Next job in the part's job_hash chain */
 };
 
+#define GS_JOB_HASH_SIZE 1024
+#define GS_JOB_HASH_INX(_job_id) ((_job_id) % GS_JOB_HASH_SIZE)
+
 struct gs_part {
 	char *part_name;
 	uint16_t priority;	/* Job priority tier */
 	uint32_t num_jobs;
 	struct gs_job **job_list;
 	uint32_t job_list_size;
+	struct gs_job **job_hash; /* Jobs in job_list, by GS_JOB_HASH_INX */
 	uint32_t num_shadows;
 	struct gs_job **shadow;  /* see '"Shadow" Design' below */
 	uint32_t shadow_size;
@@ -326,11 +333,31 @@ static void _destroy_parts(void *x)
 	FREE_NULL_BITMAP(gs_part_ptr->active_resmap);
 	xfree(gs_part_ptr->active_cpus);
 	xfree(gs_part_ptr->job_list);
+	xfree(gs_part_ptr->job_hash);
 	xfree(gs_part_ptr);
 }
 
+/* This is the reverse order defined by list.h so to generated a list in
+ *	descending order rather than ascending order */
+static int _sort_partitions(void *part1, void *part2)
+{
+	struct gs_part *g1;
+	struct gs_part *g2;
+	int prio1;
+	int prio2;
+
+	g1 = *(struct gs_part **)part1;
+	g2 = *(struct gs_part **)part2;
+
+	prio1 = g1->priority;
+	prio2 = g2->priority;
+
+	return prio2 - prio1;
+}
+
 /* Build the gs_part_list. The job_list will be created later,
- * once a job is added. */
+ * once a job is added. The gs_part_list is sorted by descending
+ * priority, which only changes when it is rebuilt. */
 static void _build_parts(void)
 {
 	ListIterator part_iterator;
@@ -358,6 +385,7 @@ static void _build_parts(void)
 		list_append(gs_part_list, gs_part_ptr);
 	}
 	list_iterator_destroy(part_iterator);
+	list_sort(gs_part_list, _sort_partitions);
 }
 
 /* Find the gs_part entity with the given name */
@@ -373,14 +401,50 @@ static int _find_gs_part(void *x, void *key)
 /* Find the job_list index of the given job_id in the given partition */
 static int _find_job_index(struct gs_part *p_ptr, uint32_t job_id)
 {
-	int i;
-	for (i = 0; i < p_ptr->num_jobs; i++) {
-		if (p_ptr->job_list[i]->job_ptr->job_id == job_id)
-			return i;
+	struct gs_job *j_ptr;
+
+	if (!p_ptr->job_hash)
+		return -1;
+	j_ptr = p_ptr->job_hash[GS_JOB_HASH_INX(job_id)];
+	while (j_ptr) {
+		if (j_ptr->job_id == job_id)
+			return j_ptr->job_inx;
+		j_ptr = j_ptr->job_next;
 	}
 	return -1;
 }
 
+/* Add the given job to its partition's job_hash */
+static void _add_job_hash(struct gs_part *p_ptr, struct gs_job *j_ptr)
+{
+	int inx = GS_JOB_HASH_INX(j_ptr->job_id);
+
+	if (!p_ptr->job_hash) {
+		p_ptr->job_hash = xmalloc(GS_JOB_HASH_SIZE *
+					  sizeof(struct gs_job *));
+	}
+	j_ptr->job_next = p_ptr->job_hash[inx];
+	p_ptr->job_hash[inx] = j_ptr;
+}
+
+/* Remove the given job from its partition's job_hash */
+static void _remove_job_hash(struct gs_part *p_ptr, struct gs_job *j_ptr)
+{
+	struct gs_job **j_pptr;
+
+	if (!p_ptr->job_hash)
+		return;
+	j_pptr = &p_ptr->job_hash[GS_JOB_HASH_INX(j_ptr->job_id)];
+	while (*j_pptr) {
+		if (*j_pptr == j_ptr) {
+			*j_pptr = j_ptr->job_next;
+			break;
+		}
+		j_pptr = &(*j_pptr)->job_next;
+	}
+	j_ptr->job_next = NULL;
+}
+
 /* Return 1 if job "cpu count" fits in this row, else return 0 */
 static int _can_cpus_fit(struct job_record *job_ptr, struct gs_part *p_ptr)
 {
@@ -415,7 +479,6 @@ static int _job_fits_in_active_row(struct job_record *job_ptr,
 {
 	job_resources_t *job_res = job_ptr->job_resrcs;
 	int count;
-	bitstr_t *job_map;
 	uint16_t job_gr_type;
 
 	if ((p_ptr->active_resmap == NULL) || (p_ptr->jobs_active == 0))
@@ -429,13 +492,10 @@ static int _job_fits_in_active_row(struct job_record *job_ptr,
 	}
 
 	/* job_gr_type == GS_NODE || job_gr_type == GS_CPU */
-	job_map = bit_copy(job_res->node_bitmap);
-	bit_and(job_map, p_ptr->active_resmap);
-	/* any set bits indicate contention for the same resource */
-	count = bit_set_count(job_map);
+	/* any overlapping bits indicate contention for the same resource */
+	count = bit_overlap(job_res->node_bitmap, p_ptr->active_resmap);
 	if (slurmctld_conf.debug_flags & DEBUG_FLAG_GANG)
 		info("gang: _job_fits_in_active_row: %d bits conflict", count);
-	FREE_NULL_BITMAP(job_map);
 	if (count == 0)
 		return 1;
 	if (job_gr_type == GS_CPU) {
@@ -695,31 +755,17 @@ static void _preempt_job_dequeue(void)
 	return;
 }
 
-/* This is the reverse order defined by list.h so to generated a list in
- *	descending order rather than ascending order */
-static int _sort_partitions(void *part1, void *part2)
-{
-	struct gs_part *g1;
-	struct gs_part *g2;
-	int prio1;
-	int prio2;
-
-	g1 = *(struct gs_part **)part1;
-	g2 = *(struct gs_part **)part2;
-
-	prio1 = g1->priority;
-	prio2 = g2->priority;
-
-	return prio2 - prio1;
-}
-
 /* Scan the partition list. Add the given job as a "shadow" to every
  * partition with a lower priority than the given partition */
 static void _cast_shadow(struct gs_job *j_ptr, uint16_t priority)
 {
 	ListIterator part_iterator;
 	struct gs_part *p_ptr;
-	int i;
+
+	/* the shadow is already on every lower priority partition */
+	if (j_ptr->shadow_cast)
+		return;
+	j_ptr->shadow_cast = true;
 
 	part_iterator = list_iterator_create(gs_part_list);
 	while ((p_ptr = (struct gs_part *) list_next(part_iterator))) {
@@ -733,14 +779,6 @@ static void _cast_shadow(struct gs_job *j_ptr, uint16_t priority)
 			p_ptr->shadow = xmalloc(p_ptr->shadow_size *
 						sizeof(struct gs_job *));
 			/* 'shadow' is initialized to be NULL filled */
-		} else {
-			/* does this shadow already exist? */
-			for (i = 0; i < p_ptr->num_shadows; i++) {
-				if (p_ptr->shadow[i] == j_ptr)
-					break;
-			}
-			if (i < p_ptr->num_shadows)
-				continue;
 		}
 
 		if (p_ptr->num_shadows+1 >= p_ptr->shadow_size) {
@@ -761,6 +799,11 @@ static void _clear_shadow(struct gs_job *j_ptr)
 	struct gs_part *p_ptr;
 	int i;
 
+	/* the job has no shadow on any partition */
+	if (!j_ptr->shadow_cast)
+		return;
+	j_ptr->shadow_cast = false;
+
 	part_iterator = list_iterator_create(gs_part_list);
 	while ((p_ptr = (struct gs_part *) list_next(part_iterator))) {
 		if (!p_ptr->shadow)
@@ -894,11 +937,9 @@ static void _update_all_active_rows(void)
 	ListIterator part_iterator;
  	struct gs_part *p_ptr;
 
-	/* Sort the partitions. This way the shadows of any high-priority
-	 * jobs are appropriately adjusted before the lower priority
-	 * partitions are updated */
-	list_sort(gs_part_list, _sort_partitions);
-
+	/* The partitions are sorted by priority when gs_part_list is built.
+	 * This way the shadows of any high-priority jobs are appropriately
+	 * adjusted before the lower priority partitions are updated */
 	part_iterator = list_iterator_create(gs_part_list);
 	while ((p_ptr = (struct gs_part *) list_next(part_iterator)))
 		_update_active_row(p_ptr, 1);
@@ -934,11 +975,13 @@ static void _remove_job_from_part(uint32_t job_id, struct gs_part *p_ptr,
 
 	/* remove any shadow first */
 	_clear_shadow(j_ptr);
+	_remove_job_hash(p_ptr, j_ptr);
 
 	/* remove the job from the job_list by shifting everyone else down */
 	p_ptr->num_jobs--;
 	for (; i < p_ptr->num_jobs; i++) {
 		p_ptr->job_list[i] = p_ptr->job_list[i+1];
+		p_ptr->job_list[i]->job_inx = i;
 	}
 	p_ptr->job_list[i] = NULL;
 
@@ -1018,7 +1061,9 @@ static uint16_t _add_job_to_part(struct gs_part *p_ptr,
 	j_ptr->row_state = GS_NO_ACTIVE; /* job is not in the active row */
 
 	/* append this job to the job_list */
+	j_ptr->job_inx = p_ptr->num_jobs;
 	p_ptr->job_list[p_ptr->num_jobs++] = j_ptr;
+	_add_job_hash(p_ptr, j_ptr);
 
 	/* determine the immediate fate of this job (run or suspend) */
 	if (!IS_JOB_SUSPENDED(job_ptr) &&
@@ -1490,30 +1535,36 @@ static void _build_active_row(struct gs_part *p_ptr)
  *    resmap are moved to the back of the list (preserving their order among
  *    each other).
  * 4. Loop back to step 2, starting with the new "first job in the list".
+ *
+ * Step 3 is done in a single pass over the job_list, collecting the active
+ * jobs in a separate array and appending them after the others.
  */
 static void _cycle_job_list(struct gs_part *p_ptr)
 {
-	int i, j;
-	struct gs_job *j_ptr;
+	int i, j, k;
+	struct gs_job *j_ptr, **active_jobs;
 	uint16_t preempt_mode;
 
 	if (slurmctld_conf.debug_flags & DEBUG_FLAG_GANG)
 		info("gang: entering %s", __func__);
 	/* re-prioritize the job_list and set all row_states to GS_NO_ACTIVE */
-	for (i = 0; i < p_ptr->num_jobs; i++) {
-		while (p_ptr->job_list[i]->row_state == GS_ACTIVE) {
+	active_jobs = xmalloc(sizeof(struct gs_job *) * (p_ptr->num_jobs + 1));
+	for (i = 0, j = 0, k = 0; i < p_ptr->num_jobs; i++) {
+		j_ptr = p_ptr->job_list[i];
+		if (j_ptr->row_state == GS_ACTIVE) {
 			/* move this job to the back row and "deactivate" it */
-			j_ptr = p_ptr->job_list[i];
-			j_ptr->row_state = GS_NO_ACTIVE;
-			for (j = i; j+1 < p_ptr->num_jobs; j++) {
-				p_ptr->job_list[j] = p_ptr->job_list[j+1];
-			}
-			p_ptr->job_list[j] = j_ptr;
+			active_jobs[k++] = j_ptr;
+		} else {
+			j_ptr->job_inx = j;
+			p_ptr->job_list[j++] = j_ptr;
 		}
-		if (p_ptr->job_list[i]->row_state == GS_FILLER)
-			p_ptr->job_list[i]->row_state = GS_NO_ACTIVE;
-
+		j_ptr->row_state = GS_NO_ACTIVE;
+	}
+	for (i = 0; i < k; i++, j++) {
+		active_jobs[i]->job_inx = j;
+		p_ptr->job_list[j] = active_jobs[i];
 	}
+	xfree(active_jobs);
 	if (slurmctld_conf.debug_flags & DEBUG_FLAG_GANG)
 		info("gang: %s reordered job list:", __func__);
 	/* Rebuild the active row. */
@@ -1594,7 +1645,6 @@ static void *_timeslicer_thread(void *arg)
 
 		lock_slurmctld(job_write_lock);
 		slurm_mutex_lock(&data_mutex);
-		list_sort(gs_part_list, _sort_partitions);
 
 		/* scan each partition... */
 		if (slurmctld_conf.debug_flags & DEBUG_FLAG_GANG)
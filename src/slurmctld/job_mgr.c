@@ -2257,6 +2257,8 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 
 	_add_job_hash(job_ptr);
 	_add_job_array_hash(job_ptr);
+	if (IS_JOB_RUNNING(job_ptr) || IS_JOB_SUSPENDED(job_ptr))
+		preempt_cand_add(job_ptr);
 
 	memset(&assoc_rec, 0, sizeof(slurmdb_assoc_rec_t));
 
@@ -3960,6 +3962,7 @@ extern void excise_node_from_job(struct job_record *job_ptr,
 	}
 
 	job_ptr->total_nodes = job_ptr->node_cnt = new_pos + 1;
+	preempt_cand_update(job_ptr);
 
 	FREE_NULL_BITMAP(orig_bitmap);
 	(void) select_g_job_resized(job_ptr, node_ptr);
@@ -4450,6 +4453,8 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	details_new->cpu_freq_max = job_details->cpu_freq_max;
 	details_new->cpu_freq_gov = job_details->cpu_freq_gov;
 	details_new->depend_list = depended_list_copy(job_details->depend_list);
+	/* Existing graph edges now refer to job_ptr_pend by job ID */
+	job_depend_link(job_ptr);
 	details_new->dependency = xstrdup(job_details->dependency);
 	details_new->orig_dependency = xstrdup(job_details->orig_dependency);
 	if (job_details->env_cnt) {
@@ -5460,6 +5465,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 				break;
 			job_ptr = job_ptr->job_array_next_j;
 		}
+		acct_policy_submit_batch_begin();
 		while (job_ptr) {
 			if ((job_ptr->array_job_id == job_id) &&
 			    (job_ptr != job_ptr_done)) {
@@ -5474,6 +5480,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 			}
 			job_ptr = job_ptr->job_array_next_j;
 		}
+		acct_policy_submit_batch_end();
 		if ((rc == SLURM_SUCCESS) && (jobs_done == jobs_signaled))
 			return ESLURM_ALREADY_DONE;
 		return rc;
@@ -5607,6 +5614,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		i_last = bit_fls(array_bitmap);
 	else
 		i_last = -2;
+	acct_policy_submit_batch_begin();
 	for (i = i_first; i <= i_last; i++) {
 		if (!bit_test(array_bitmap, i))
 			continue;
@@ -5621,6 +5629,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		rc2 = job_signal(job_ptr, signal, flags, uid, preempt);
 		rc = MAX(rc, rc2);
 	}
+	acct_policy_submit_batch_end();
 endit:
 	FREE_NULL_BITMAP(array_bitmap);
 
@@ -9116,6 +9125,8 @@ static void _list_delete_job(void *job_entry)
 		_remove_job_hash(job_ptr, JOB_HASH_ARRAY_JOB);
 		_remove_job_hash(job_ptr, JOB_HASH_ARRAY_TASK);
 	}
+	job_depend_notify(job_ptr, true);
+	preempt_cand_remove(job_ptr);
 
 	_delete_job_details(job_ptr);
 	xfree(job_ptr->account);
@@ -10654,6 +10665,10 @@ static void _reset_step_bitmaps(struct job_record *job_ptr)
 	ListIterator step_iterator;
 	struct step_record *step_ptr;
 
+	/* Step node bitmaps are rebuilt below, so are the per-node counts */
+	if (job_ptr->job_resrcs)
+		xfree(job_ptr->job_resrcs->steps_per_node);
+
 	step_iterator = list_iterator_create (job_ptr->step_list);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		if (step_ptr->state < JOB_RUNNING)
@@ -12653,6 +12668,7 @@ static int _update_job(struct job_record *job_ptr, job_desc_msg_t * job_specs,
 				job_ptr->job_state |= JOB_COMPLETE;
 				_realloc_nodes(expand_job_ptr,
 					       orig_jobx_node_bitmap);
+				preempt_cand_update(expand_job_ptr);
 				rebuild_step_bitmaps(expand_job_ptr,
 						     orig_jobx_node_bitmap);
 				(void) gs_job_fini(job_ptr);
@@ -14395,6 +14411,7 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 	job_ptr->pre_sus_time = 0;
 	job_ptr->suspend_time = 0;
 	job_ptr->tot_sus_time = 0;
+	job_ptr->preempt_time = 0;
 	/* Current code (<= 2.1) has it so we start the new job with the next
 	 * step id.  This could be used when restarting to figure out which
 	 * step the previous run of this job stopped on. */
@@ -14461,6 +14478,7 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 void job_fini (void)
 {
 	FREE_NULL_LIST(job_list);
+	job_depend_fini();
 	xfree(job_hash);
 	xfree(job_array_hash_j);
 	xfree(job_array_hash_t);
@@ -14559,6 +14577,9 @@ extern void job_completion_logger(struct job_record *job_ptr, bool requeue)
 	xassert(job_ptr);
 
 	acct_policy_remove_job_submit(job_ptr);
+	job_depend_notify(job_ptr, false);
+	preempt_cand_remove(job_ptr);
+	trigger_job_fini();
 	if (job_ptr->nodes && ((job_ptr->bit_flags & JOB_KILL_HURRY) == 0)
 	    && !IS_JOB_RESIZING(job_ptr)) {
 		(void) bb_g_job_start_stage_out(job_ptr);
@@ -14712,8 +14733,13 @@ extern bool job_independent(struct job_record *job_ptr, int will_run)
 		return false;
 
 	/* Test dependencies first so we can cancel jobs before dependent
-	 * job records get purged (e.g. afterok, afternotok) */
-	depend_rc = test_job_dependency(job_ptr);
+	 * job records get purged (e.g. afterok, afternotok). Unless a job
+	 * it depends upon changed state since the last test, the result is
+	 * unchanged. */
+	if (detail_ptr && detail_ptr->depend_clean)
+		depend_rc = 1;
+	else
+		depend_rc = test_job_dependency(job_ptr);
 	if (depend_rc == 1) {
 		/* start_time has passed but still has dependency which
 		 * makes it ineligible */
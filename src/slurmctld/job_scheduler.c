@@ -111,6 +111,14 @@ typedef struct wait_boot_arg {
 	bitstr_t *node_bitmap;
 } wait_boot_arg_t;
 
+/* Reverse job dependency graph edge, hashed by the job depended upon */
+typedef struct depend_edge {
+	uint32_t dep_job_id;		/* job with the dependency */
+	uint32_t depend_gen;		/* depend_gen of dep_job_id */
+	uint32_t job_id;		/* job depended upon */
+	struct depend_edge *next;
+} depend_edge_t;
+
 static char **	_build_env(struct job_record *job_ptr, bool is_epilog);
 static batch_job_launch_msg_t *_build_launch_job_msg(struct job_record *job_ptr,
 						     uint16_t protocol_version);
@@ -148,6 +156,10 @@ static int sched_min_interval = 2;
 static int bb_array_stage_cnt = 10;
 extern diag_stats_t slurmctld_diag_stats;
 
+static depend_edge_t **depend_hash = NULL;
+static uint32_t depend_hash_size = 0;
+static uint32_t depend_gen = 0;
+
 /*
  * Calculate how busy the system is by figuring out how busy each node is.
  */
@@ -240,6 +252,13 @@ static void _job_queue_append(List job_queue, struct job_record *job_ptr,
 	job_queue_rec->job_ptr  = job_ptr;
 	job_queue_rec->part_ptr = part_ptr;
 	job_queue_rec->priority = prio;
+	job_queue_rec->has_resv = (job_ptr->resv_id != 0);
+	if (job_ptr->array_task_id == NO_VAL)
+		job_queue_rec->sort_job_id = job_ptr->job_id;
+	else
+		job_queue_rec->sort_job_id = job_ptr->array_job_id;
+	if (job_ptr->details)
+		job_queue_rec->submit_time = job_ptr->details->submit_time;
 	list_append(job_queue, job_queue_rec);
 }
 
@@ -1163,6 +1182,7 @@ static int _schedule(uint32_t job_limit)
 	now = time(NULL);
 	sched_start = now;
 	last_job_sched_start = now;
+	update_frag_stats();
 	START_TIMER;
 	if (!avail_front_end(NULL)) {
 		ListIterator job_iterator = list_iterator_create(job_list);
@@ -1854,10 +1874,8 @@ extern int sort_job_queue2(void *x, void *y)
 {
 	job_queue_rec_t *job_rec1 = *(job_queue_rec_t **) x;
 	job_queue_rec_t *job_rec2 = *(job_queue_rec_t **) y;
-	bool has_resv1, has_resv2;
 	static time_t config_update = 0;
 	static bool preemption_enabled = true;
-	uint32_t job_id1, job_id2;
 	uint32_t p1, p2;
 
 	/* The following block of code is designed to minimize run time in
@@ -1873,11 +1891,9 @@ extern int sort_job_queue2(void *x, void *y)
 			return 1;
 	}
 
-	has_resv1 = (job_rec1->job_ptr->resv_id != 0);
-	has_resv2 = (job_rec2->job_ptr->resv_id != 0);
-	if (has_resv1 && !has_resv2)
+	if (job_rec1->has_resv && !job_rec2->has_resv)
 		return -1;
-	if (!has_resv1 && has_resv2)
+	if (!job_rec1->has_resv && job_rec2->has_resv)
 		return 1;
 
 	if (job_rec1->part_ptr && job_rec2->part_ptr) {
@@ -1889,47 +1905,27 @@ extern int sort_job_queue2(void *x, void *y)
 			return -1;
 	}
 
-	if (job_rec1->job_ptr->part_ptr_list &&
-	    job_rec1->job_ptr->priority_array)
-		p1 = job_rec1->priority;
-	else
-		p1 = job_rec1->job_ptr->priority;
-
-
-	if (job_rec2->job_ptr->part_ptr_list &&
-	    job_rec2->job_ptr->priority_array)
-		p2 = job_rec2->priority;
-	else
-		p2 = job_rec2->job_ptr->priority;
-
-
-	if (p1 < p2)
+	/*
+	 * job_queue_rec_t priority is the job's priority in that partition,
+	 * taken from priority_array[] if the job has multiple partitions
+	 */
+	if (job_rec1->priority < job_rec2->priority)
 		return 1;
-	if (p1 > p2)
+	if (job_rec1->priority > job_rec2->priority)
 		return -1;
 
 	/* If the priorities are the same sort by submission time */
-	if (job_rec1->job_ptr->details && job_rec2->job_ptr->details) {
-		if (job_rec1->job_ptr->details->submit_time >
-		    job_rec2->job_ptr->details->submit_time)
+	if (job_rec1->submit_time && job_rec2->submit_time) {
+		if (job_rec1->submit_time > job_rec2->submit_time)
 			return 1;
-		if (job_rec2->job_ptr->details->submit_time >
-		    job_rec1->job_ptr->details->submit_time)
+		if (job_rec2->submit_time > job_rec1->submit_time)
 			return -1;
 	}
 
 	/* If the submission times are the same sort by increasing job id's */
-	if (job_rec1->array_task_id == NO_VAL)
-		job_id1 = job_rec1->job_id;
-	else
-		job_id1 = job_rec1->job_ptr->array_job_id;
-	if (job_rec2->array_task_id == NO_VAL)
-		job_id2 = job_rec2->job_id;
-	else
-		job_id2 = job_rec2->job_ptr->array_job_id;
-	if (job_id1 > job_id2)
+	if (job_rec1->sort_job_id > job_rec2->sort_job_id)
 		return 1;
-	else if (job_id1 < job_id2)
+	else if (job_rec1->sort_job_id < job_rec2->sort_job_id)
 		return -1;
 
 	/* If job IDs match compare task IDs */
@@ -2585,6 +2581,128 @@ static void _depend_list2str(struct job_record *job_ptr, bool set_or_flag)
 	list_iterator_destroy(depend_iter);
 }
 
+/*
+ * job_depend_link - Record this job in the reverse dependency graph as a
+ *	dependent of every job in its depend_list, so that a state change of
+ *	any of those jobs forces its dependencies to be tested again
+ * IN job_ptr - dependent job
+ */
+extern void job_depend_link(struct job_record *job_ptr)
+{
+	ListIterator depend_iter;
+	struct depend_spec *dep_ptr;
+	depend_edge_t *edge_ptr;
+	uint32_t inx;
+
+	if (job_ptr->details == NULL)
+		return;
+
+	/* Edges added for any previous depend_list are now stale */
+	if (++depend_gen == 0)
+		depend_gen = 1;
+	job_ptr->details->depend_gen = depend_gen;
+	job_ptr->details->depend_clean = false;
+	if (job_ptr->details->depend_list == NULL)
+		return;
+
+	if (!depend_hash) {
+		depend_hash_size = MAX(slurmctld_conf.max_job_cnt, 1024);
+		depend_hash = xmalloc(sizeof(depend_edge_t *) *
+				      depend_hash_size);
+	}
+
+	depend_iter = list_iterator_create(job_ptr->details->depend_list);
+	while ((dep_ptr = list_next(depend_iter))) {
+		if (dep_ptr->job_id == 0)	/* Singleton */
+			continue;
+		if (!find_job_record(dep_ptr->job_id) &&
+		    !find_job_array_rec(dep_ptr->job_id, INFINITE))
+			continue;	/* Job gone, tested on next pass */
+		edge_ptr = xmalloc(sizeof(depend_edge_t));
+		edge_ptr->dep_job_id = job_ptr->job_id;
+		edge_ptr->depend_gen = depend_gen;
+		edge_ptr->job_id = dep_ptr->job_id;
+		inx = dep_ptr->job_id % depend_hash_size;
+		edge_ptr->next = depend_hash[inx];
+		depend_hash[inx] = edge_ptr;
+	}
+	list_iterator_destroy(depend_iter);
+}
+
+/*
+ * Flag the jobs depending upon job_id for a full dependency test.
+ * Edges of jobs which are gone or have a new depend_list are released.
+ */
+static void _depend_notify(uint32_t job_id, bool purge)
+{
+	depend_edge_t **edge_pptr, *edge_ptr;
+	struct job_record *dep_job_ptr;
+
+	edge_pptr = &depend_hash[job_id % depend_hash_size];
+	while ((edge_ptr = *edge_pptr)) {
+		if (edge_ptr->job_id != job_id) {
+			edge_pptr = &edge_ptr->next;
+			continue;
+		}
+		dep_job_ptr = find_job_record(edge_ptr->dep_job_id);
+		if (dep_job_ptr && dep_job_ptr->details &&
+		    (dep_job_ptr->details->depend_gen ==
+		     edge_ptr->depend_gen)) {
+			dep_job_ptr->details->depend_clean = false;
+			if (!purge) {
+				edge_pptr = &edge_ptr->next;
+				continue;
+			}
+		}
+		*edge_pptr = edge_ptr->next;
+		xfree(edge_ptr);
+	}
+}
+
+/*
+ * job_depend_notify - A job started, completed or is being purged. Flag the
+ *	jobs which depend upon it so their dependencies get tested again.
+ * IN job_ptr - job which changed state
+ * IN purge - if set, also release the graph edges to this job's dependents,
+ *	job_ptr must already be removed from the job hash tables
+ */
+extern void job_depend_notify(struct job_record *job_ptr, bool purge)
+{
+	if (!depend_hash)
+		return;
+
+	/*
+	 * Tasks of a job array share the edges of their array_job_id, keep
+	 * them until the last record of the job array is purged
+	 */
+	if (purge && find_job_array_rec(job_ptr->job_id, INFINITE))
+		purge = false;
+	_depend_notify(job_ptr->job_id, purge);
+	/* Dependencies upon a job array as a whole or one of its tasks */
+	if (job_ptr->array_job_id && (job_ptr->array_job_id != job_ptr->job_id))
+		_depend_notify(job_ptr->array_job_id, false);
+}
+
+/* job_depend_fini - free the reverse dependency graph */
+extern void job_depend_fini(void)
+{
+	depend_edge_t *edge_ptr, *next_ptr;
+	uint32_t inx;
+
+	if (!depend_hash)
+		return;
+
+	for (inx = 0; inx < depend_hash_size; inx++) {
+		for (edge_ptr = depend_hash[inx]; edge_ptr;
+		     edge_ptr = next_ptr) {
+			next_ptr = edge_ptr->next;
+			xfree(edge_ptr);
+		}
+	}
+	xfree(depend_hash);
+	depend_hash_size = 0;
+}
+
 /*
  * Determine if a job's dependencies are met
  * RET: 0 = no dependencies
@@ -2596,20 +2714,31 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	ListIterator depend_iter, job_iterator;
 	struct depend_spec *dep_ptr;
 	bool failure = false, depends = false, rebuild_str = false;
-	bool or_satisfied = false;
+	bool or_satisfied = false, retest = false;
  	List job_queue = NULL;
  	bool run_now;
 	int results = 0;
 	struct job_record *qjob_ptr, *djob_ptr, *dcjob_ptr;
 
-	if ((job_ptr->details == NULL) ||
-	    (job_ptr->details->depend_list == NULL) ||
+	if (job_ptr->details == NULL)
+		return 0;
+	job_ptr->details->depend_clean = false;
+	if ((job_ptr->details->depend_list == NULL) ||
 	    (list_count(job_ptr->details->depend_list) == 0))
 		return 0;
 
 	depend_iter = list_iterator_create(job_ptr->details->depend_list);
 	while ((dep_ptr = list_next(depend_iter))) {
 		bool clear_dep = false;
+		/*
+		 * These do not depend only upon the state of the job depended
+		 * upon (or the burst buffer stage-out follows its completion),
+		 * so they are tested on every pass
+		 */
+		if ((dep_ptr->depend_type == SLURM_DEPEND_SINGLETON) ||
+		    (dep_ptr->depend_type == SLURM_DEPEND_EXPAND) ||
+		    (dep_ptr->depend_type == SLURM_DEPEND_BURST_BUFFER))
+			retest = true;
 		dep_ptr->job_ptr = find_job_array_rec(dep_ptr->job_id,
 						      dep_ptr->array_task_id);
 		djob_ptr = dep_ptr->job_ptr;
@@ -2806,6 +2935,13 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	else if (depends)
 		results = 1;
 
+	/*
+	 * Until a job it depends upon changes state (see job_depend_notify()),
+	 * the result of this test can not change
+	 */
+	if ((results == 1) && !retest)
+		job_ptr->details->depend_clean = true;
+
 	return results;
 }
 
@@ -2940,6 +3076,7 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 	    ((new_depend[0] == '0') && (new_depend[1] == '\0'))) {
 		xfree(job_ptr->details->dependency);
 		FREE_NULL_LIST(job_ptr->details->depend_list);
+		job_ptr->details->depend_clean = false;
 		return rc;
 
 	}
@@ -3194,6 +3331,7 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 	if (rc == SLURM_SUCCESS) {
 		FREE_NULL_LIST(job_ptr->details->depend_list);
 		job_ptr->details->depend_list = new_depend_list;
+		job_depend_link(job_ptr);
 		_depend_list2str(job_ptr, or_flag);
 #if _DEBUG
 		print_job_dependency(job_ptr);
@@ -3207,12 +3345,13 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 
 /* Return true if job_id is found in dependency_list.
  * Pass NULL dependency list to clear the counter.
- * Execute recursively for each dependent job */
+ * Execute recursively for each dependent job, visiting each job only once */
 static bool _scan_depend(List dependency_list, uint32_t job_id)
 {
 	static time_t sched_update = 0;
 	static int max_depend_depth = 10;
 	static int job_counter = 0;
+	static uint32_t scan_stamp = 0;
 	bool rc = false;
 	ListIterator iter;
 	struct depend_spec *dep_ptr;
@@ -3239,6 +3378,7 @@ static bool _scan_depend(List dependency_list, uint32_t job_id)
 
 	if (dependency_list == NULL) {
 		job_counter = 0;
+		scan_stamp++;
 		return false;
 	} else if (job_counter++ >= max_depend_depth) {
 		return false;
@@ -3256,7 +3396,10 @@ static bool _scan_depend(List dependency_list, uint32_t job_id)
 			continue;	/* purged job, ptr not yet cleared */
 		else if (!IS_JOB_FINISHED(dep_ptr->job_ptr) &&
 			 dep_ptr->job_ptr->details &&
-			 dep_ptr->job_ptr->details->depend_list) {
+			 dep_ptr->job_ptr->details->depend_list &&
+			 (dep_ptr->job_ptr->details->depend_scan !=
+			  scan_stamp)) {
+			dep_ptr->job_ptr->details->depend_scan = scan_stamp;
 			rc = _scan_depend(dep_ptr->job_ptr->details->
 					  depend_list, job_id);
 			if (rc) {
@@ -3368,6 +3511,12 @@ extern int job_start_data(job_desc_msg_t *job_desc_msg,
 	if ((job_ptr->details == NULL) || (!IS_JOB_PENDING(job_ptr)))
 		return ESLURM_DISABLED;
 
+	/*
+	 * The preemption candidates depend upon the job record rather than
+	 * the partition being tested, so find them once for all partitions.
+	 */
+	preemptee_candidates = slurm_find_preemptable_jobs(job_ptr);
+
 	if (job_ptr->part_ptr_list) {
 		list_sort(job_ptr->part_ptr_list, _part_weight_sort);
 		iter = list_iterator_create(job_ptr->part_ptr_list);
@@ -3379,6 +3528,7 @@ next_part:
 	if (part_ptr == NULL) {
 		if (iter)
 			list_iterator_destroy(iter);
+		FREE_NULL_LIST(preemptee_candidates);
 		return ESLURM_INVALID_PARTITION_NAME;
 	}
 
@@ -3392,6 +3542,7 @@ next_part:
 		/* Don't need to check for each partition */
 		if (iter)
 			list_iterator_destroy(iter);
+		FREE_NULL_LIST(preemptee_candidates);
 		return ESLURM_INVALID_NODE_NAME;
 	}
 
@@ -3429,6 +3580,7 @@ next_part:
 
 		if (iter)
 			list_iterator_destroy(iter);
+		FREE_NULL_LIST(preemptee_candidates);
 		return i;
 	}
 	bit_and(avail_bitmap, resv_bitmap);
@@ -3455,7 +3607,6 @@ next_part:
 			req_nodes = max_nodes;
 		else
 			req_nodes = min_nodes;
-		preemptee_candidates = slurm_find_preemptable_jobs(job_ptr);
 
 		/* The orig_start is based upon the backfill scheduler data
 		 * and considers all higher priority jobs. The logic below
@@ -3537,7 +3688,6 @@ next_part:
 		rc = ESLURM_REQUESTED_NODE_CONFIG_UNAVAILABLE;
 	}
 
-	FREE_NULL_LIST(preemptee_candidates);
 	FREE_NULL_LIST(preemptee_job_list);
 	FREE_NULL_BITMAP(avail_bitmap);
 	FREE_NULL_BITMAP(exc_core_bitmap);
@@ -3547,6 +3697,7 @@ next_part:
 
 	if (iter)
 		list_iterator_destroy(iter);
+	FREE_NULL_LIST(preemptee_candidates);
 
 	return rc;
 }
@@ -51,6 +51,13 @@ typedef struct job_queue_rec {
 	struct part_record *part_ptr;	/* Pointer to partition record. Each
 					 * job may have multiple partitions. */
 	uint32_t priority;		/* Job priority in THIS partition */
+	/*
+	 * Sort keys copied from the job record by build_job_queue() so that
+	 * sort_job_queue2() need not dereference each job record
+	 */
+	bool has_resv;			/* Job has an advanced reservation */
+	uint32_t sort_job_id;		/* Job ID or job array's master ID */
+	time_t submit_time;		/* Time of job submission, 0 if unknown */
 } job_queue_rec_t;
 
 /*
@@ -94,6 +101,26 @@ extern void epilog_slurmctld(struct job_record *job_ptr);
  */
 extern void feature_list_delete(void *x);
 
+/*
+ * job_depend_link - Record this job in the reverse dependency graph as a
+ *	dependent of every job in its depend_list, so that a state change of
+ *	any of those jobs forces its dependencies to be tested again
+ * IN job_ptr - dependent job
+ */
+extern void job_depend_link(struct job_record *job_ptr);
+
+/*
+ * job_depend_notify - A job started, completed or is being purged. Flag the
+ *	jobs which depend upon it so their dependencies get tested again.
+ * IN job_ptr - job which changed state
+ * IN purge - if set, also release the graph edges to this job's dependents,
+ *	job_ptr must already be removed from the job hash tables
+ */
+extern void job_depend_notify(struct job_record *job_ptr, bool purge);
+
+/* job_depend_fini - free the reverse dependency graph */
+extern void job_depend_fini(void);
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * IN/OUT  eff_cg_bitmap - optional bitmap of all relevent completing nodes,
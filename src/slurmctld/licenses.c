@@ -48,6 +48,7 @@
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/licenses.h"
@@ -55,9 +56,37 @@
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/slurm_accounting_storage.h"
 
+/* Future availability of one license, as planned by the backfill scheduler */
+typedef struct bf_license_step {
+	time_t		when;		/* time this step begins */
+	int32_t		avail;		/* licenses available from "when" */
+} bf_license_step_t;
+
+typedef struct bf_license {
+	char *		name;		/* name associated with a license */
+	uint32_t	step_cnt;	/* count of steps in use */
+	uint32_t	step_size;	/* count of steps allocated */
+	bf_license_step_t *step;	/* availability steps, sorted by time */
+} bf_license_t;
+
+/* Arguments of the license_job_test/get/return() per license functions */
+typedef struct {
+	struct job_record *job_ptr;
+	bool reboot;
+	int rc;
+	time_t when;
+} license_job_args_t;
+
 List license_list = (List) NULL;
 time_t last_license_update = 0;
 static pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Index of license_list records by position and by name */
+static licenses_t **license_table = NULL;
+static uint32_t license_table_cnt = 0;
+static xhash_t *license_hash = NULL;
+static bool license_table_valid = false;
+
 static void _pack_license(struct licenses *lic, Buf buffer, uint16_t protocol_version);
 
 /* Print all licenses on a list */
@@ -120,6 +149,79 @@ static int _license_find_remote_rec(void *x, void *key)
 	return _license_find_rec(x, key);
 }
 
+/* Return the name of a license_t record (for use by xhash) */
+static const char *_license_hash_id(void *x)
+{
+	licenses_t *license_entry = (licenses_t *) x;
+
+	return license_entry->name;
+}
+
+/*
+ * Rebuild license_table and license_hash from license_list, recording each
+ * record's position in its id field. license_mutex must be locked.
+ */
+static void _license_table_build(void)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+
+	license_table_valid = true;
+	license_table_cnt = 0;
+	if (license_hash)
+		xhash_clear(license_hash);
+	else
+		license_hash = xhash_init(_license_hash_id, NULL);
+	if (!license_list)
+		return;
+
+	xrealloc(license_table,
+		 sizeof(licenses_t *) * (list_count(license_list) + 1));
+	iter = list_iterator_create(license_list);
+	while ((license_entry = (licenses_t *) list_next(iter))) {
+		license_entry->id = license_table_cnt;
+		license_table[license_table_cnt++] = license_entry;
+		if (!xhash_get(license_hash, license_entry->name))
+			xhash_add(license_hash, license_entry);
+	}
+	list_iterator_destroy(iter);
+}
+
+/*
+ * Find the license_list record with the given name.
+ * license_mutex must be locked.
+ */
+static licenses_t *_license_find_name(char *name)
+{
+	if (!license_table_valid)
+		_license_table_build();
+	if (!name)
+		return NULL;
+	return (licenses_t *) xhash_get(license_hash, name);
+}
+
+/*
+ * Find the license_list record matching a job's license record. The
+ * record's position is cached in the job's record, so repeated lookups
+ * need no hash lookup. license_mutex must be locked.
+ */
+static licenses_t *_license_find(licenses_t *license_entry)
+{
+	licenses_t *match;
+
+	if (!license_table_valid)
+		_license_table_build();
+	if ((license_entry->id < license_table_cnt) &&
+	    !xstrcmp(license_table[license_entry->id]->name,
+		     license_entry->name))
+		return license_table[license_entry->id];
+
+	match = _license_find_name(license_entry->name);
+	if (match)
+		license_entry->id = match->id;
+	return match;
+}
+
 /* Given a license string, return a list of license_t records */
 static List _build_license_list(char *licenses, bool *valid)
 {
@@ -170,6 +272,7 @@ static List _build_license_list(char *licenses, bool *valid)
 			license_entry = xmalloc(sizeof(licenses_t));
 			license_entry->name = xstrdup(token);
 			license_entry->total = num;
+			license_entry->id = NO_VAL;
 			list_push(lic_list, license_entry);
 		}
 		token = strtok_r(NULL, ",;", &last);
@@ -223,6 +326,7 @@ static void _add_res_rec_2_lic_list(slurmdb_res_rec_t *rec, bool sync)
 	license_entry->remote = sync ? 2 : 1;
 
 	list_push(license_list, license_entry);
+	license_table_valid = false;
 	last_license_update = time(NULL);
 }
 
@@ -265,6 +369,7 @@ extern int license_init(char *licenses)
 	license_list = _build_license_list(licenses, &valid);
 	if (!valid)
 		fatal("Invalid configured licenses: %s", licenses);
+	license_table_valid = false;
 
 	_licenses_print("init_license", license_list, NULL);
 	slurm_mutex_unlock(&license_mutex);
@@ -285,6 +390,7 @@ extern int license_update(char *licenses)
                 fatal("Invalid configured licenses: %s", licenses);
 
         slurm_mutex_lock(&license_mutex);
+	license_table_valid = false;
         if (!license_list) {        /* no licenses before now */
                 license_list = new_list;
                 slurm_mutex_unlock(&license_mutex);
@@ -432,6 +538,7 @@ extern void license_remove_remote(slurmdb_res_rec_t *rec)
 			     "removed with %u in use",
 			     license_entry->name, license_entry->used);
 			list_delete_item(iter);
+			license_table_valid = false;
 			last_license_update = time(NULL);
 			break;
 		}
@@ -500,6 +607,7 @@ extern void license_sync_remote(List res_list)
 			     "removed with %u in use",
 			     license_entry->name, license_entry->used);
 			list_delete_item(iter);
+			license_table_valid = false;
 			last_license_update = time(NULL);
 		} else if (license_entry->remote == 2)
 			license_entry->remote = 1;
@@ -514,6 +622,10 @@ extern void license_free(void)
 {
 	slurm_mutex_lock(&license_mutex);
 	FREE_NULL_LIST(license_list);
+	xfree(license_table);
+	license_table_cnt = 0;
+	xhash_free(license_hash);
+	license_table_valid = false;
 	slurm_mutex_unlock(&license_mutex);
 }
 
@@ -557,12 +669,7 @@ extern List license_validate(char *licenses, bool validate_configured,
 	_licenses_print("request_license", job_license_list, NULL);
 	iter = list_iterator_create(job_license_list);
 	while ((license_entry = (licenses_t *) list_next(iter))) {
-		if (license_list) {
-			match = list_find_first(license_list,
-						_license_find_rec,
-						license_entry->name);
-		} else
-			match = NULL;
+		match = _license_find(license_entry);
 		if (!match) {
 			debug("License name requested (%s) does not exist",
 			      license_entry->name);
@@ -614,6 +721,44 @@ extern void license_job_merge(struct job_record *job_ptr)
 	job_ptr->licenses = license_list_to_string(job_ptr->license_list);
 }
 
+/*
+ * Test one license record of a job (for use by list_find_first)
+ * RET 1 to stop with args->rc set if the license is not available
+ */
+static int _license_job_test_rec(void *x, void *arg)
+{
+	licenses_t *license_entry = (licenses_t *) x, *match;
+	license_job_args_t *args = (license_job_args_t *) arg;
+	int resv_licenses;
+
+	match = _license_find(license_entry);
+	if (!match) {
+		error("could not find license %s for job %u",
+		      license_entry->name, args->job_ptr->job_id);
+		args->rc = SLURM_ERROR;
+		return 1;
+	} else if (license_entry->total > match->total) {
+		info("job %u wants more %s licenses than configured",
+		     args->job_ptr->job_id, match->name);
+		args->rc = SLURM_ERROR;
+		return 1;
+	} else if ((license_entry->total + match->used) > match->total) {
+		args->rc = EAGAIN;
+		return 1;
+	}
+
+	/* Assume node reboot required since we have not
+	 * selected the compute nodes yet */
+	resv_licenses = job_test_lic_resv(args->job_ptr, license_entry->name,
+					  args->when, args->reboot);
+	if ((license_entry->total + match->used + resv_licenses) >
+	    match->total) {
+		args->rc = EAGAIN;
+		return 1;
+	}
+	return 0;
+}
+
 /*
  * license_job_test - Test if the licenses required for a job are available
  * IN job_ptr - job identification
@@ -624,48 +769,21 @@ extern void license_job_merge(struct job_record *job_ptr)
 extern int license_job_test(struct job_record *job_ptr, time_t when,
 			    bool reboot)
 {
-	ListIterator iter;
-	licenses_t *license_entry, *match;
-	int rc = SLURM_SUCCESS, resv_licenses;
+	license_job_args_t args = {
+		.job_ptr = job_ptr,
+		.reboot = reboot,
+		.rc = SLURM_SUCCESS,
+		.when = when,
+	};
 
 	if (!job_ptr->license_list)	/* no licenses needed */
-		return rc;
+		return args.rc;
 
 	slurm_mutex_lock(&license_mutex);
-	iter = list_iterator_create(job_ptr->license_list);
-	while ((license_entry = (licenses_t *) list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
-		if (!match) {
-			error("could not find license %s for job %u",
-			      license_entry->name, job_ptr->job_id);
-			rc = SLURM_ERROR;
-			break;
-		} else if (license_entry->total > match->total) {
-			info("job %u wants more %s licenses than configured",
-			     job_ptr->job_id, match->name);
-			rc = SLURM_ERROR;
-			break;
-		} else if ((license_entry->total + match->used) >
-			   match->total) {
-			rc = EAGAIN;
-			break;
-		} else {
-			/* Assume node reboot required since we have not
-			 * selected the compute nodes yet */
-			resv_licenses = job_test_lic_resv(job_ptr,
-							  license_entry->name,
-							  when, reboot);
-			if ((license_entry->total + match->used +
-			     resv_licenses) > match->total) {
-				rc = EAGAIN;
-				break;
-			}
-		}
-	}
-	list_iterator_destroy(iter);
+	(void) list_find_first(job_ptr->license_list, _license_job_test_rec,
+			       &args);
 	slurm_mutex_unlock(&license_mutex);
-	return rc;
+	return args.rc;
 }
 
 /*
@@ -688,12 +806,31 @@ extern List license_job_copy(List license_list_src)
 		license_entry_dest = xmalloc(sizeof(licenses_t));
 		license_entry_dest->name = xstrdup(license_entry_src->name);
 		license_entry_dest->total = license_entry_src->total;
+		license_entry_dest->id = license_entry_src->id;
 		list_push(license_list_dest, license_entry_dest);
 	}
 	list_iterator_destroy(iter);
 	return license_list_dest;
 }
 
+/* Get one license record of a job (for use by list_for_each) */
+static int _license_job_get_rec(void *x, void *arg)
+{
+	licenses_t *license_entry = (licenses_t *) x, *match;
+	license_job_args_t *args = (license_job_args_t *) arg;
+
+	match = _license_find(license_entry);
+	if (match) {
+		match->used += license_entry->total;
+		license_entry->used += license_entry->total;
+	} else {
+		error("could not find license %s for job %u",
+		      license_entry->name, args->job_ptr->job_id);
+		args->rc = SLURM_ERROR;
+	}
+	return 0;
+}
+
 /*
  * license_job_get - Get the licenses required for a job
  * IN job_ptr - job identification
@@ -701,33 +838,47 @@ extern List license_job_copy(List license_list_src)
  */
 extern int license_job_get(struct job_record *job_ptr)
 {
-	ListIterator iter;
-	licenses_t *license_entry, *match;
-	int rc = SLURM_SUCCESS;
+	license_job_args_t args = {
+		.job_ptr = job_ptr,
+		.rc = SLURM_SUCCESS,
+	};
 
 	if (!job_ptr->license_list)	/* no licenses needed */
-		return rc;
+		return args.rc;
 
 	last_license_update = time(NULL);
 
 	slurm_mutex_lock(&license_mutex);
-	iter = list_iterator_create(job_ptr->license_list);
-	while ((license_entry = (licenses_t *) list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
-		if (match) {
-			match->used += license_entry->total;
-			license_entry->used += license_entry->total;
-		} else {
-			error("could not find license %s for job %u",
-			      license_entry->name, job_ptr->job_id);
-			rc = SLURM_ERROR;
-		}
-	}
-	list_iterator_destroy(iter);
+	(void) list_for_each(job_ptr->license_list, _license_job_get_rec,
+			     &args);
 	_licenses_print("acquire_license", license_list, job_ptr);
 	slurm_mutex_unlock(&license_mutex);
-	return rc;
+	return args.rc;
+}
+
+/* Return one license record of a job (for use by list_for_each) */
+static int _license_job_return_rec(void *x, void *arg)
+{
+	licenses_t *license_entry = (licenses_t *) x, *match;
+	license_job_args_t *args = (license_job_args_t *) arg;
+
+	match = _license_find(license_entry);
+	if (match) {
+		if (match->used >= license_entry->total)
+			match->used -= license_entry->total;
+		else {
+			error("%s: license use count underflow for %s",
+			      __func__, match->name);
+			match->used = 0;
+			args->rc = SLURM_ERROR;
+		}
+		license_entry->used = 0;
+	} else {
+		/* This can happen after a reconfiguration */
+		error("%s: job returning unknown license name %s",
+		      __func__, license_entry->name);
+	}
+	return 0;
 }
 
 /*
@@ -737,42 +888,264 @@ extern int license_job_get(struct job_record *job_ptr)
  */
 extern int license_job_return(struct job_record *job_ptr)
 {
-	ListIterator iter;
-	licenses_t *license_entry, *match;
-	int rc = SLURM_SUCCESS;
+	license_job_args_t args = {
+		.job_ptr = job_ptr,
+		.rc = SLURM_SUCCESS,
+	};
 
 	if (!job_ptr->license_list)	/* no licenses needed */
-		return rc;
+		return args.rc;
 
 	last_license_update = time(NULL);
 	trace_job(job_ptr, __func__, "");
 	slurm_mutex_lock(&license_mutex);
+	(void) list_for_each(job_ptr->license_list, _license_job_return_rec,
+			     &args);
+	_licenses_print("return_license", license_list, job_ptr);
+	slurm_mutex_unlock(&license_mutex);
+	return args.rc;
+}
+
+/* Free a bf_license_t record (for use by FREE_NULL_LIST) */
+static void _bf_license_free(void *x)
+{
+	bf_license_t *bf_lic = (bf_license_t *) x;
+
+	if (bf_lic) {
+		xfree(bf_lic->name);
+		xfree(bf_lic->step);
+		xfree(bf_lic);
+	}
+}
+
+/* Find a bf_license_t record by license name (for use by list_find_first) */
+static int _bf_license_find(void *x, void *key)
+{
+	bf_license_t *bf_lic = (bf_license_t *) x;
+	char *name = (char *) key;
+
+	if ((bf_lic->name == NULL) || (name == NULL))
+		return 0;
+	if (xstrcmp(bf_lic->name, name))
+		return 0;
+	return 1;
+}
+
+/* Add "delta" to the licenses available from time "when" onward */
+static void _bf_license_add(bf_license_t *bf_lic, time_t when, int32_t delta)
+{
+	int i;
+
+	if (when < bf_lic->step[0].when)
+		when = bf_lic->step[0].when;
+	for (i = bf_lic->step_cnt - 1; i > 0; i--) {
+		if (bf_lic->step[i].when <= when)
+			break;
+	}
+	if (bf_lic->step[i].when != when) {
+		if (bf_lic->step_cnt >= bf_lic->step_size) {
+			bf_lic->step_size *= 2;
+			xrealloc(bf_lic->step, sizeof(bf_license_step_t) *
+					       bf_lic->step_size);
+		}
+		i++;
+		memmove(&bf_lic->step[i + 1], &bf_lic->step[i],
+			sizeof(bf_license_step_t) * (bf_lic->step_cnt - i));
+		bf_lic->step[i].when  = when;
+		bf_lic->step[i].avail = bf_lic->step[i - 1].avail;
+		bf_lic->step_cnt++;
+	}
+	for ( ; i < bf_lic->step_cnt; i++)
+		bf_lic->step[i].avail += delta;
+}
+
+/*
+ * Return the fewest licenses available at any time in [start, end).
+ * OUT later - time of the first increase in availability after start,
+ *	zero if availability never increases
+ */
+static int32_t _bf_license_min(bf_license_t *bf_lic, time_t start,
+			       time_t end, time_t *later)
+{
+	int32_t avail = INT32_MAX;
+	int i;
+
+	*later = 0;
+	for (i = 0; i < bf_lic->step_cnt; i++) {
+		if (bf_lic->step[i].when >= end)
+			break;
+		if (((i + 1) < bf_lic->step_cnt) &&
+		    (bf_lic->step[i + 1].when <= start))
+			continue;
+		avail = MIN(avail, bf_lic->step[i].avail);
+	}
+	for (i = 1; i < bf_lic->step_cnt; i++) {
+		if ((bf_lic->step[i].when > start) &&
+		    (bf_lic->step[i].avail > bf_lic->step[i - 1].avail)) {
+			*later = bf_lic->step[i].when;
+			break;
+		}
+	}
+
+	return avail;
+}
+
+/*
+ * bf_licenses_initial - Build the future availability of every configured
+ *	license for use by the backfill scheduler. Licenses held by running
+ *	jobs are returned at the job's expected end time. Licenses held by
+ *	suspended jobs are never returned.
+ * IN now - time the availability profile starts
+ * RET list of availability records, NULL if no licenses are configured.
+ *	Release using bf_licenses_free()
+ * NOTE: Caller must hold a read lock on the job list
+ */
+extern List bf_licenses_initial(time_t now)
+{
+	ListIterator iter, lic_iter;
+	licenses_t *license_entry;
+	bf_license_t *bf_lic;
+	struct job_record *job_ptr;
+	List bf_list = NULL;
+
+	slurm_mutex_lock(&license_mutex);
+	if (license_list && list_count(license_list)) {
+		bf_list = list_create(_bf_license_free);
+		iter = list_iterator_create(license_list);
+		while ((license_entry = (licenses_t *) list_next(iter))) {
+			bf_lic = xmalloc(sizeof(bf_license_t));
+			bf_lic->name = xstrdup(license_entry->name);
+			bf_lic->step_size = 16;
+			bf_lic->step = xmalloc(sizeof(bf_license_step_t) *
+					       bf_lic->step_size);
+			bf_lic->step_cnt = 1;
+			bf_lic->step[0].when = now;
+			bf_lic->step[0].avail = (int32_t) license_entry->total -
+						(int32_t) license_entry->used;
+			list_append(bf_list, bf_lic);
+		}
+		list_iterator_destroy(iter);
+	}
+	slurm_mutex_unlock(&license_mutex);
+
+	if (!bf_list)
+		return bf_list;
+
+	iter = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(iter))) {
+		if (!job_ptr->license_list || IS_JOB_SUSPENDED(job_ptr))
+			continue;
+		lic_iter = list_iterator_create(job_ptr->license_list);
+		while ((license_entry = (licenses_t *) list_next(lic_iter))) {
+			if (license_entry->used == 0)
+				continue;
+			bf_lic = list_find_first(bf_list, _bf_license_find,
+						 license_entry->name);
+			if (!bf_lic)
+				continue;
+			_bf_license_add(bf_lic, MAX(job_ptr->end_time, now + 1),
+					(int32_t) license_entry->used);
+		}
+		list_iterator_destroy(lic_iter);
+	}
+	list_iterator_destroy(iter);
+
+	return bf_list;
+}
+
+/*
+ * bf_licenses_avail - Test if the licenses required for a job are available
+ *	for its entire run time based upon the backfill availability profile
+ * IN bf_list - availability records from bf_licenses_initial()
+ * IN job_ptr - job identification
+ * IN start - expected start time of the job
+ * IN end - expected end time of the job
+ * OUT later - earliest later start time at which the licenses might be
+ *	available, zero if never
+ * RET true if the licenses are available
+ */
+extern bool bf_licenses_avail(List bf_list, struct job_record *job_ptr,
+			      time_t start, time_t end, time_t *later)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+	bf_license_t *bf_lic;
+	int32_t avail;
+	int resv_licenses;
+	time_t lic_later;
+	bool rc = true;
+
+	*later = 0;
+	if (!bf_list || !job_ptr->license_list)	/* no licenses needed */
+		return rc;
+
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = (licenses_t *) list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
-		if (match) {
-			if (match->used >= license_entry->total)
-				match->used -= license_entry->total;
-			else {
-				error("%s: license use count underflow for %s",
-				      __func__, match->name);
-				match->used = 0;
-				rc = SLURM_ERROR;
-			}
-			license_entry->used = 0;
-		} else {
-			/* This can happen after a reconfiguration */
-			error("%s: job returning unknown license name %s",
-			      __func__, license_entry->name);
+		bf_lic = list_find_first(bf_list, _bf_license_find,
+					 license_entry->name);
+		if (!bf_lic) {
+			*later = 0;
+			rc = false;
+			break;
 		}
+		resv_licenses = job_test_lic_resv(job_ptr, license_entry->name,
+						  start, true);
+		avail = _bf_license_min(bf_lic, start, end, &lic_later);
+		if ((int64_t) avail >=
+		    ((int64_t) license_entry->total + resv_licenses))
+			continue;
+		rc = false;
+		if (lic_later == 0) {
+			/* Availability never increases, job can not start */
+			*later = 0;
+			break;
+		}
+		*later = MAX(*later, lic_later);
 	}
 	list_iterator_destroy(iter);
-	_licenses_print("return_license", license_list, job_ptr);
-	slurm_mutex_unlock(&license_mutex);
+
 	return rc;
 }
 
+/*
+ * bf_licenses_deduct - Remove the licenses required for a job from the
+ *	backfill availability profile for the period [start, end)
+ * IN bf_list - availability records from bf_licenses_initial()
+ * IN job_ptr - job identification
+ * IN start - expected start time of the job
+ * IN end - expected end time of the job
+ */
+extern void bf_licenses_deduct(List bf_list, struct job_record *job_ptr,
+			       time_t start, time_t end)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+	bf_license_t *bf_lic;
+
+	if (!bf_list || !job_ptr->license_list)	/* no licenses needed */
+		return;
+
+	iter = list_iterator_create(job_ptr->license_list);
+	while ((license_entry = (licenses_t *) list_next(iter))) {
+		bf_lic = list_find_first(bf_list, _bf_license_find,
+					 license_entry->name);
+		if (!bf_lic)
+			continue;
+		_bf_license_add(bf_lic, start, -(int32_t) license_entry->total);
+		if (end > start) {
+			_bf_license_add(bf_lic, end,
+					(int32_t) license_entry->total);
+		}
+	}
+	list_iterator_destroy(iter);
+}
+
+/* bf_licenses_free - Free the backfill license availability records */
+extern void bf_licenses_free(List bf_list)
+{
+	FREE_NULL_LIST(bf_list);
+}
+
 /*
  * license_list_overlap - test if there is any overlap in licenses
  *	names found in the two lists
@@ -861,13 +1234,8 @@ extern uint32_t get_total_license_cnt(char *name)
 	licenses_t *lic;
 
 	slurm_mutex_lock(&license_mutex);
-	if (license_list) {
-		lic = list_find_first(
-			license_list, _license_find_rec, name);
-
-		if (lic)
-			count = lic->total;
-	}
+	if ((lic = _license_find_name(name)))
+		count = lic->total;
 	slurm_mutex_unlock(&license_mutex);
 
 	return count;
@@ -47,12 +47,53 @@ typedef struct licenses {
 	uint32_t	total;		/* total license configued */
 	uint32_t	used;		/* used licenses */
 	uint8_t         remote;	        /* non-zero if remote (from database) */
+	uint32_t	id;		/* index into the configured licenses,
+					 * cached in job records */
 } licenses_t;
 
 extern List license_list;
 extern List clus_license_list;
 extern time_t last_license_update;
 
+/*
+ * bf_licenses_initial - Build the future availability of every configured
+ *	license for use by the backfill scheduler. Licenses held by running
+ *	jobs are returned at the job's expected end time.
+ * IN now - time the availability profile starts
+ * RET list of availability records, NULL if no licenses are configured.
+ *	Release using bf_licenses_free()
+ * NOTE: Caller must hold a read lock on the job list
+ */
+extern List bf_licenses_initial(time_t now);
+
+/*
+ * bf_licenses_avail - Test if the licenses required for a job are available
+ *	for its entire run time based upon the backfill availability profile
+ * IN bf_list - availability records from bf_licenses_initial()
+ * IN job_ptr - job identification
+ * IN start - expected start time of the job
+ * IN end - expected end time of the job
+ * OUT later - earliest later start time at which the licenses might be
+ *	available, zero if never
+ * RET true if the licenses are available
+ */
+extern bool bf_licenses_avail(List bf_list, struct job_record *job_ptr,
+			      time_t start, time_t end, time_t *later);
+
+/*
+ * bf_licenses_deduct - Remove the licenses required for a job from the
+ *	backfill availability profile for the period [start, end)
+ * IN bf_list - availability records from bf_licenses_initial()
+ * IN job_ptr - job identification
+ * IN start - expected start time of the job
+ * IN end - expected end time of the job
+ */
+extern void bf_licenses_deduct(List bf_list, struct job_record *job_ptr,
+			       time_t start, time_t end);
+
+/* bf_licenses_free - Free the backfill license availability records */
+extern void bf_licenses_free(List bf_list);
+
 /* Get string of used license information. Caller must xfree return value */
 extern char *get_licenses_used(void);
 
@@ -1807,6 +1807,7 @@ static int _update_node_weight(char *node_names, uint32_t weight)
 	struct config_record *config_ptr, *new_config_ptr;
 	struct config_record *first_new = NULL;
 	int rc, config_cnt, tmp_cnt;
+	int i, i_first, i_last;
 
 	rc = node_name2bitmap(node_names, false, &node_bitmap);
 	if (rc) {
@@ -1853,6 +1854,17 @@ static int _update_node_weight(char *node_names, uint32_t weight)
 		FREE_NULL_BITMAP(tmp_bitmap);
 	}
 	list_iterator_destroy(config_iterator);
+
+	/* Let the select plugin refresh any data derived from node weight */
+	i_first = bit_ffs(node_bitmap);
+	if (i_first >= 0)
+		i_last = bit_fls(node_bitmap);
+	else
+		i_last = i_first - 1;
+	for (i = i_first; i <= i_last; i++) {
+		if (bit_test(node_bitmap, i))
+			select_g_update_node_config(i);
+	}
 	FREE_NULL_BITMAP(node_bitmap);
 
 	info("_update_node_weight: nodes %s weight set to: %u",
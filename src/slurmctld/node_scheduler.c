@@ -2280,13 +2280,23 @@ static void _preempt_jobs(List preemptee_job_list, bool kill_pending,
 	ListIterator iter;
 	struct job_record *job_ptr;
 	uint16_t mode;
-	int job_cnt = 0, rc;
+	int job_cnt = 0, preempt_cnt = 0, rc;
 	checkpoint_msg_t ckpt_msg;
+	time_t now = time(NULL);
 
 	iter = list_iterator_create(preemptee_job_list);
 	while ((job_ptr = (struct job_record *) list_next(iter))) {
 		rc = SLURM_SUCCESS;
 		mode = slurm_job_preempt_mode(job_ptr);
+		/* Jobs in their grace time were counted when first signaled */
+		if (kill_pending && !job_ptr->preempt_time &&
+		    ((mode == PREEMPT_MODE_CANCEL) ||
+		     (mode == PREEMPT_MODE_CHECKPOINT) ||
+		     (mode == PREEMPT_MODE_REQUEUE))) {
+			preempt_cnt++;
+			slurmctld_diag_stats.preempt_cpu_secs +=
+				preempt_job_cost(job_ptr, now);
+		}
 		if (mode == PREEMPT_MODE_CANCEL) {
 			job_cnt++;
 			if (!kill_pending)
@@ -2356,6 +2366,13 @@ static void _preempt_jobs(List preemptee_job_list, bool kill_pending,
 	}
 	list_iterator_destroy(iter);
 
+	if (preempt_cnt > 0) {
+		slurmctld_diag_stats.preempt_events++;
+		slurmctld_diag_stats.preempt_jobs += preempt_cnt;
+		slurmctld_diag_stats.preempt_spared +=
+			preemptor_ptr->details->preempt_spared;
+	}
+	preemptor_ptr->details->preempt_spared = 0;
 	if (job_cnt > 0)
 		*error_code = ESLURM_NODES_BUSY;
 }
@@ -2887,6 +2904,8 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 
 	job_ptr->job_state = JOB_RUNNING;
 	job_ptr->bit_flags |= JOB_WAS_RUNNING;
+	job_depend_notify(job_ptr, false);
+	preempt_cand_add(job_ptr);
 
 	if (select_g_select_nodeinfo_set(job_ptr) != SLURM_SUCCESS) {
 		error("select_g_select_nodeinfo_set(%pJ): %m", job_ptr);
@@ -72,6 +72,9 @@
 #define MAX_SHUTDOWN_DELAY	10	/* seconds to wait for child procs
 					 * to exit after daemon shutdown
 					 * request, then orphan or kill proc */
+#define PLAN_MAX_AGE		300	/* seconds after which a backfill
+					 * plan not since replaced is
+					 * ignored */
 
 /* Records for tracking processes forked to suspend/resume nodes */
 typedef struct proc_track_struct {
@@ -105,6 +108,16 @@ bitstr_t *suspend_node_bitmap = NULL, *resume_node_bitmap = NULL;
 int   suspend_cnt,   resume_cnt;
 float suspend_cnt_f, resume_cnt_f;
 
+/*
+ * Earliest planned job start time on each node from the last backfill
+ * cycle, zero if none. plan_build is only used by the backfill thread,
+ * plan_start is published under plan_mutex.
+ */
+static pthread_mutex_t plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static time_t *plan_start = NULL, *plan_build = NULL;
+static int plan_node_cnt = 0, plan_build_cnt = 0;
+static time_t plan_time = (time_t) 0;
+
 static void  _clear_power_config(void);
 static void  _do_failed_nodes(char *hosts);
 static void  _do_power_work(time_t now);
@@ -253,10 +266,21 @@ static int _pick_exc_nodes(void *x, void *arg)
 	return 0;
 }
 
+/*
+ * Return true if the backfill plan has a job starting on the given node
+ * at or before the given time. Call with plan_mutex locked.
+ */
+static bool _node_planned(int node_inx, time_t when)
+{
+	if (!plan_start || !plan_start[node_inx])
+		return false;
+	return (plan_start[node_inx] <= when);
+}
+
 /* Perform any power change work to nodes */
 static void _do_power_work(time_t now)
 {
-	int i, wake_cnt = 0, susp_total = 0;
+	int i, wake_cnt = 0, plan_wake_cnt = 0, susp_total = 0;
 	time_t delta_t;
 	uint32_t susp_state;
 	bitstr_t *avoid_node_bitmap = NULL, *failed_node_bitmap = NULL;
@@ -342,6 +366,15 @@ static void _do_power_work(time_t now)
 			avoid_node_bitmap = bit_copy(exc_node_bitmap);
 	}
 
+	/* Discard a backfill plan that is stale or for other nodes */
+	slurm_mutex_lock(&plan_mutex);
+	if (plan_start &&
+	    ((plan_node_cnt != node_record_count) ||
+	     (plan_time < (now - PLAN_MAX_AGE)))) {
+		xfree(plan_start);
+		plan_node_cnt = 0;
+	}
+
 	/* Build bitmaps identifying each node which should change state */
 	for (i = 0, node_ptr = node_record_table_ptr;
 	     i < node_record_count; i++, node_ptr++) {
@@ -355,11 +388,23 @@ static void _do_power_work(time_t now)
 		    ((resume_rate == 0) || (resume_cnt < resume_rate))	&&
 		    (bit_test(suspend_node_bitmap, i) == 0)		&&
 		    (IS_NODE_ALLOCATED(node_ptr) ||
-		     (node_ptr->last_idle > (now - idle_time)))) {
+		     (node_ptr->last_idle > (now - idle_time)) ||
+		     _node_planned(i, now + resume_timeout))) {
 			if (wake_node_bitmap == NULL) {
 				wake_node_bitmap =
 					bit_alloc(node_record_count);
 			}
+			/*
+			 * A node woken for a planned job start stays in
+			 * avail_node_bitmap so backfill can keep planning
+			 * that job on it, see _add_booting_nodes() there.
+			 * Booting nodes are not allocated until they respond.
+			 */
+			if (!IS_NODE_ALLOCATED(node_ptr) &&
+			    (node_ptr->last_idle <= (now - idle_time)))
+				plan_wake_cnt++;
+			else
+				bit_clear(avail_node_bitmap, i);
 			wake_cnt++;
 			resume_cnt++;
 			resume_cnt_f++;
@@ -367,7 +412,6 @@ static void _do_power_work(time_t now)
 			node_ptr->node_state |=   NODE_STATE_POWER_UP;
 			node_ptr->node_state |=   NODE_STATE_NO_RESPOND;
 			bit_clear(power_node_bitmap, i);
-			bit_clear(avail_node_bitmap, i);
 			node_ptr->boot_req_time = now;
 			node_ptr->last_response = now + resume_timeout;
 			bit_set(booting_node_bitmap, i);
@@ -385,6 +429,7 @@ static void _do_power_work(time_t now)
 		    (!IS_NODE_POWER_UP(node_ptr))			&&
 		    (node_ptr->last_idle != 0)				&&
 		    (node_ptr->last_idle < (now - idle_time))		&&
+		    !_node_planned(i, now + idle_time)			&&
 		    ((avoid_node_bitmap == NULL) ||
 		     (bit_test(avoid_node_bitmap, i) == 0))) {
 			if (sleep_node_bitmap == NULL) {
@@ -436,7 +481,12 @@ static void _do_power_work(time_t now)
 			}
 		}
 	}
+	slurm_mutex_unlock(&plan_mutex);
 	FREE_NULL_BITMAP(avoid_node_bitmap);
+	if (plan_wake_cnt) {
+		verbose("power_save: resuming %d nodes for planned job starts",
+			plan_wake_cnt);
+	}
 	if (((now - last_log) > 600) && (susp_total > 0)) {
 		info("Power save mode: %d nodes", susp_total);
 		last_log = now;
@@ -480,6 +530,77 @@ static void _do_power_work(time_t now)
 	}
 }
 
+/*
+ * power_save_plan_begin - Start a new plan of job starts by the backfill
+ *	scheduler, discarding any plan not yet published
+ */
+extern void power_save_plan_begin(void)
+{
+	if (!power_save_enabled) {
+		xfree(plan_build);
+		plan_build_cnt = 0;
+		return;
+	}
+
+	if (plan_build_cnt != node_record_count) {
+		xfree(plan_build);
+		plan_build_cnt = node_record_count;
+		plan_build = xmalloc(sizeof(time_t) * plan_build_cnt);
+	} else {
+		memset(plan_build, 0, sizeof(time_t) * plan_build_cnt);
+	}
+}
+
+/*
+ * power_save_plan_nodes - Add a planned job start to the plan
+ * IN node_bitmap - nodes the job is planned to use
+ * IN start_time - planned start time of the job
+ */
+extern void power_save_plan_nodes(bitstr_t *node_bitmap, time_t start_time)
+{
+	int i, i_first, i_last;
+
+	if (!plan_build || !node_bitmap)
+		return;
+
+	i_first = bit_ffs(node_bitmap);
+	if (i_first >= 0)
+		i_last = bit_fls(node_bitmap);
+	else
+		i_last = i_first - 1;
+	if (i_last >= plan_build_cnt)
+		i_last = plan_build_cnt - 1;
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(node_bitmap, i))
+			continue;
+		if (!plan_build[i] || (start_time < plan_build[i]))
+			plan_build[i] = start_time;
+	}
+}
+
+/*
+ * power_save_plan_end - Publish the plan built since power_save_plan_begin
+ *	for use by the power save thread
+ */
+extern void power_save_plan_end(void)
+{
+	time_t *tmp_plan;
+	int tmp_cnt;
+
+	if (!plan_build)
+		return;
+
+	slurm_mutex_lock(&plan_mutex);
+	tmp_plan = plan_start;
+	tmp_cnt = plan_node_cnt;
+	plan_start = plan_build;
+	plan_node_cnt = plan_build_cnt;
+	plan_time = time(NULL);
+	plan_build = tmp_plan;
+	plan_build_cnt = tmp_plan ? tmp_cnt : 0;
+	slurm_mutex_unlock(&plan_mutex);
+}
+
 /*
  * power_job_reboot - Reboot compute nodes for a job from the head node.
  * Also change the modes of KNL nodes for node_features/knl_cray plugin.
@@ -1039,6 +1160,10 @@ static void *_init_power_save(void *arg)
 fini:	_clear_power_config();
 	FREE_NULL_BITMAP(suspend_node_bitmap);
 	FREE_NULL_BITMAP(resume_node_bitmap);
+	slurm_mutex_lock(&plan_mutex);
+	xfree(plan_start);
+	plan_node_cnt = 0;
+	slurm_mutex_unlock(&plan_mutex);
 	_shutdown_power();
 	slurm_mutex_lock(&power_mutex);
 	list_destroy(proc_track_list);
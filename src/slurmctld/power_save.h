@@ -60,4 +60,16 @@ extern bool power_save_test(void);
 /* power_job_reboot - Reboot compute nodes for a job from the head node */
 extern int power_job_reboot(struct job_record *job_ptr);
 
+/*
+ * Record the backfill scheduler's planned job starts so that powered down
+ * nodes can be resumed ahead of time and nodes with planned work are not
+ * suspended. Called by the backfill thread only.
+ * power_save_plan_begin - start a new plan, discarding any unpublished one
+ * power_save_plan_nodes - plan a job start on the given nodes
+ * power_save_plan_end - publish the plan for use by the power save thread
+ */
+extern void power_save_plan_begin(void);
+extern void power_save_plan_nodes(bitstr_t *node_bitmap, time_t start_time);
+extern void power_save_plan_end(void);
+
 #endif /* _HAVE_POWER_SAVE_H */
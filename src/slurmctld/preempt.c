@@ -47,6 +47,7 @@
 #include "src/common/xstring.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/job_scheduler.h"
+#include "src/slurmctld/preempt.h"
 
 typedef struct slurm_preempt_ops {
 	List		(*find_jobs)	      (struct job_record *job_ptr);
@@ -71,6 +72,12 @@ static plugin_context_t *g_context = NULL;
 static pthread_mutex_t	    g_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
 
+/* Running and suspended jobs, in no particular order */
+static struct job_record **preempt_cand = NULL;
+static uint32_t preempt_cand_cnt = 0;
+static uint32_t preempt_cand_size = 0;
+static uint32_t preempt_cand_gen = 0;
+
 static void _preempt_signal(struct job_record *job_ptr, uint32_t grace_time)
 {
 	if (job_ptr->preempt_time)
@@ -176,9 +183,104 @@ extern int slurm_preempt_fini(void)
 	init_run = false;
 	rc = plugin_context_destroy(g_context);
 	g_context = NULL;
+	xfree(preempt_cand);
+	preempt_cand_cnt = 0;
+	preempt_cand_size = 0;
 	return rc;
 }
 
+/* Return true if the job is in the preemption candidate array */
+static bool _preempt_cand_test(struct job_record *job_ptr)
+{
+	return ((job_ptr->preempt_cand_inx < preempt_cand_cnt) &&
+		(preempt_cand[job_ptr->preempt_cand_inx] == job_ptr));
+}
+
+/*
+ * Add a job which has started running to the preemption candidates.
+ * Adding a job already present has no effect.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_add(struct job_record *job_ptr)
+{
+	if (_preempt_cand_test(job_ptr))
+		return;
+
+	if (preempt_cand_cnt >= preempt_cand_size) {
+		preempt_cand_size = MAX(preempt_cand_size * 2, 1024);
+		xrealloc(preempt_cand,
+			 sizeof(struct job_record *) * preempt_cand_size);
+	}
+	job_ptr->preempt_cand_inx = preempt_cand_cnt;
+	preempt_cand[preempt_cand_cnt++] = job_ptr;
+	preempt_cand_gen++;
+}
+
+/*
+ * Remove a job which is no longer running or suspended from the preemption
+ * candidates. Removing a job not present has no effect.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_remove(struct job_record *job_ptr)
+{
+	struct job_record *last_ptr;
+
+	if (!_preempt_cand_test(job_ptr))
+		return;
+
+	last_ptr = preempt_cand[--preempt_cand_cnt];
+	last_ptr->preempt_cand_inx = job_ptr->preempt_cand_inx;
+	preempt_cand[job_ptr->preempt_cand_inx] = last_ptr;
+	job_ptr->preempt_cand_inx = NO_VAL;
+	preempt_cand_gen++;
+}
+
+/*
+ * Note that a preemption candidate's node count changed (job resized or
+ * node removed), which may change its preemption order.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_update(struct job_record *job_ptr)
+{
+	if (_preempt_cand_test(job_ptr))
+		preempt_cand_gen++;
+}
+
+/*
+ * Return the preemption candidate array. Jobs which have ended may remain
+ * in the array until removed, so callers must test each job's state.
+ * OUT cnt - count of jobs in the array
+ * OUT gen - changed whenever a job is added, removed or resized
+ * NOTE: Caller must hold a job read lock and must not free the array
+ */
+extern struct job_record **preempt_cand_get(uint32_t *cnt, uint32_t *gen)
+{
+	*cnt = preempt_cand_cnt;
+	*gen = preempt_cand_gen;
+	return preempt_cand;
+}
+
+/*
+ * Return the cost of preempting a job: the run time which would be lost
+ * multiplied by the job's CPU count
+ */
+extern uint64_t preempt_job_cost(struct job_record *job_ptr, time_t now)
+{
+	time_t run_time;
+
+	if (IS_JOB_SUSPENDED(job_ptr))
+		run_time = job_ptr->pre_sus_time;
+	else if (job_ptr->suspend_time)
+		run_time = (time_t) difftime(now, job_ptr->suspend_time) +
+			   job_ptr->pre_sus_time;
+	else
+		run_time = (time_t) difftime(now, job_ptr->start_time);
+	if (run_time < 1)	/* Newly started jobs still cost something */
+		run_time = 1;
+
+	return (uint64_t) run_time * MAX(job_ptr->total_cpus, 1);
+}
+
 extern List slurm_find_preemptable_jobs(struct job_record *job_ptr)
 {
 	if (slurm_preempt_init() < 0)
@@ -58,6 +58,42 @@ int slurm_preempt_init(void);
  */
 extern int slurm_preempt_fini(void);
 
+/*
+ * Add a job which has started running to the preemption candidates.
+ * Adding a job already present has no effect.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_add(struct job_record *job_ptr);
+
+/*
+ * Remove a job which is no longer running or suspended from the preemption
+ * candidates. Removing a job not present has no effect.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_remove(struct job_record *job_ptr);
+
+/*
+ * Note that a preemption candidate's node count changed (job resized or
+ * node removed), which may change its preemption order.
+ * NOTE: Caller must hold a job write lock
+ */
+extern void preempt_cand_update(struct job_record *job_ptr);
+
+/*
+ * Return the preemption candidate array. Jobs which have ended may remain
+ * in the array until removed, so callers must test each job's state.
+ * OUT cnt - count of jobs in the array
+ * OUT gen - changed whenever a job is added, removed or resized
+ * NOTE: Caller must hold a job read lock and must not free the array
+ */
+extern struct job_record **preempt_cand_get(uint32_t *cnt, uint32_t *gen);
+
+/*
+ * Return the cost of preempting a job: the run time which would be lost
+ * multiplied by the job's CPU count
+ */
+extern uint64_t preempt_job_cost(struct job_record *job_ptr, time_t now);
+
 /*
  **************************************************************************
  *                          P L U G I N   C A L L S                       *
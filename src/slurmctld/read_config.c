@@ -2586,6 +2586,7 @@ static int _sync_nodes_to_active_job(struct job_record *job_ptr)
 		job_ptr->node_cnt = bit_set_count(job_ptr->node_bitmap_cg);
 	else
 		job_ptr->node_cnt = bit_set_count(job_ptr->node_bitmap);
+	preempt_cand_update(job_ptr);
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		if (job_ptr->node_bitmap_cg) { /* job completing */
 			if (bit_test(job_ptr->node_bitmap_cg, i) == 0)
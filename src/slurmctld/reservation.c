@@ -99,6 +99,37 @@ time_t    last_resv_update = (time_t) 0;
 List      resv_list = (List) NULL;
 uint32_t  top_suffix = 0;
 
+/*
+ * Interval index of resv_list. Reservations with a fixed start time are
+ * sorted by start time and searched as an implicit balanced binary tree in
+ * which each element also holds the latest end time of its subtree.
+ * Reservations with a floating start time are kept apart and always
+ * returned. Reservations of full nodes which only remove those nodes from
+ * jobs outside of them (see _resv_full_node()) are indexed apart as well,
+ * so backfill can merge them into its own node timeline once per cycle and
+ * skip them when testing each job. Only time stamps are copied, node and
+ * core bitmaps are read from the reservation records themselves.
+ */
+typedef struct resv_index_ent {
+	time_t end;		/* end_time, later for daily repeats */
+	int list_inx;		/* position in resv_list */
+	time_t max_end;		/* latest end of this subtree */
+	slurmctld_resv_t *resv_ptr;
+	time_t start;		/* MIN(start_time, start_time_first) */
+} resv_index_ent_t;
+
+#define RESV_FLAG_REPEAT (RESERVE_FLAG_DAILY | RESERVE_FLAG_WEEKDAY | \
+			  RESERVE_FLAG_WEEKEND | RESERVE_FLAG_WEEKLY)
+
+static resv_index_ent_t *resv_index = NULL;
+static time_t resv_index_advance = 0;	/* first end of a repeating resv */
+static int resv_index_cnt = 0;
+static resv_index_ent_t *resv_float = NULL;
+static int resv_float_cnt = 0;
+static resv_index_ent_t *resv_full = NULL;
+static int resv_full_cnt = 0;
+static bool resv_index_valid = false;
+
 /*
  * the two following structs enable to build a
  * planning of a constraint evolution over time
@@ -362,6 +393,7 @@ static void _restore_resv(slurmctld_resv_t *dest_resv,
 
 	dest_resv->duration = src_resv->duration;
 	dest_resv->end_time = src_resv->end_time;
+	resv_index_valid = false;
 
 	xfree(dest_resv->features);
 	dest_resv->features = src_resv->features;
@@ -434,6 +466,7 @@ static void _del_resv_rec(void *x)
 	if (resv_ptr) {
 		xassert(resv_ptr->magic == RESV_MAGIC);
 		resv_ptr->magic = 0;
+		resv_index_valid = false;
 		xfree(resv_ptr->accounts);
 		for (i = 0; i < resv_ptr->account_cnt; i++)
 			xfree(resv_ptr->account_list[i]);
@@ -1776,6 +1809,204 @@ unpack_error:
 	return NULL;
 }
 
+static int _cmp_resv_index_start(const void *x, const void *y)
+{
+	const resv_index_ent_t *ent1 = x, *ent2 = y;
+
+	if (ent1->start < ent2->start)
+		return -1;
+	if (ent1->start > ent2->start)
+		return 1;
+	return 0;
+}
+
+static int _cmp_resv_index_inx(const void *x, const void *y)
+{
+	const resv_index_ent_t *ent1 = *(resv_index_ent_t **) x;
+	const resv_index_ent_t *ent2 = *(resv_index_ent_t **) y;
+
+	return ent1->list_inx - ent2->list_inx;
+}
+
+/* Set max_end of the subtree rooted at the middle of [lo, hi) */
+static time_t _resv_index_max_end(resv_index_ent_t *index, int lo, int hi)
+{
+	int mid;
+	time_t max_end;
+
+	if (lo >= hi)
+		return (time_t) 0;
+	mid = (lo + hi) / 2;
+	max_end = index[mid].end;
+	max_end = MAX(max_end, _resv_index_max_end(index, lo, mid));
+	max_end = MAX(max_end, _resv_index_max_end(index, mid + 1, hi));
+	index[mid].max_end = max_end;
+
+	return max_end;
+}
+
+/*
+ * Test if a reservation does nothing more to jobs outside of it than remove
+ *	its nodes for a fixed time: full nodes, a fixed non-repeating start
+ *	time, no licenses and not bound to all or partition nodes
+ */
+static bool _resv_full_node(slurmctld_resv_t *resv_ptr)
+{
+	if ((resv_ptr->flags & (RESERVE_FLAG_TIME_FLOAT | RESV_FLAG_REPEAT |
+				RESERVE_FLAG_ALL_NODES |
+				RESERVE_FLAG_PART_NODES)) ||
+	    !resv_ptr->full_nodes || !resv_ptr->node_bitmap ||
+	    resv_ptr->license_list)
+		return false;
+	return true;
+}
+
+/* Rebuild the reservation interval index from resv_list */
+static void _resv_index_build(void)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+	resv_index_ent_t *ent_ptr;
+	int list_inx = 0, resv_cnt;
+
+	resv_cnt = MAX(list_count(resv_list), 1);
+	xrealloc(resv_index, sizeof(resv_index_ent_t) * resv_cnt);
+	xrealloc(resv_float, sizeof(resv_index_ent_t) * resv_cnt);
+	xrealloc(resv_full, sizeof(resv_index_ent_t) * resv_cnt);
+	resv_index_advance = (time_t) 0;
+	resv_index_cnt = 0;
+	resv_float_cnt = 0;
+	resv_full_cnt = 0;
+
+	iter = list_iterator_create(resv_list);
+	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT) {
+			ent_ptr = &resv_float[resv_float_cnt++];
+		} else if (_resv_full_node(resv_ptr)) {
+			ent_ptr = &resv_full[resv_full_cnt++];
+		} else {
+			ent_ptr = &resv_index[resv_index_cnt++];
+			if ((resv_ptr->flags & RESV_FLAG_REPEAT) &&
+			    (!resv_index_advance ||
+			     (resv_ptr->end_time < resv_index_advance)))
+				resv_index_advance = resv_ptr->end_time;
+		}
+		ent_ptr->start = MIN(resv_ptr->start_time,
+				     resv_ptr->start_time_first);
+		ent_ptr->end = resv_ptr->end_time;
+		/* _resv_overlap() tests a week of daily repeats */
+		if (resv_ptr->flags & RESERVE_FLAG_DAILY)
+			ent_ptr->end += 8 * 24 * 60 * 60;
+		ent_ptr->list_inx = list_inx++;
+		ent_ptr->resv_ptr = resv_ptr;
+	}
+	list_iterator_destroy(iter);
+
+	qsort(resv_index, resv_index_cnt, sizeof(resv_index_ent_t),
+	      _cmp_resv_index_start);
+	(void) _resv_index_max_end(resv_index, 0, resv_index_cnt);
+	qsort(resv_full, resv_full_cnt, sizeof(resv_index_ent_t),
+	      _cmp_resv_index_start);
+	(void) _resv_index_max_end(resv_full, 0, resv_full_cnt);
+	resv_index_valid = true;
+}
+
+static void _resv_index_search(resv_index_ent_t *index, int lo, int hi,
+			       time_t start_time, time_t end_time,
+			       resv_index_ent_t **match, int *match_cnt)
+{
+	int mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (index[mid].max_end <= start_time)
+			return;		/* whole subtree ends earlier */
+		_resv_index_search(index, lo, mid, start_time, end_time,
+				   match, match_cnt);
+		if (index[mid].start >= end_time)
+			return;		/* right subtree starts later */
+		if (index[mid].end > start_time)
+			match[(*match_cnt)++] = &index[mid];
+		lo = mid + 1;
+	}
+}
+
+/*
+ * Make the reservation index current
+ * IN advance - if set, first advance expired repeating reservations
+ */
+static void _resv_index_ready(bool advance)
+{
+	time_t now;
+	int i;
+
+	if (!resv_index_valid ||
+	    (list_count(resv_list) !=
+	     (resv_index_cnt + resv_full_cnt + resv_float_cnt)))
+		_resv_index_build();
+
+	if (advance && resv_index_advance &&
+	    (resv_index_advance <= (now = time(NULL)))) {
+		for (i = 0; i < resv_index_cnt; i++) {
+			if (resv_index[i].resv_ptr->end_time <= now)
+				_advance_resv_time(resv_index[i].resv_ptr);
+		}
+		if (!resv_index_valid)
+			_resv_index_build();
+	}
+}
+
+/*
+ * Find the reservations which may overlap the time window [start_time,
+ *	end_time). Callers must still test each reservation's times, the
+ *	result also includes every reservation with a floating start time.
+ * IN start_time, end_time - time window of interest
+ * IN advance - if set, first advance expired repeating reservations
+ * IN skip_full - if set, leave out the reservations of resv_full_node_spans()
+ * OUT resv_cnt - number of reservations returned
+ * RET reservations in resv_list order, xfree the array (not its contents)
+ */
+static slurmctld_resv_t **_resv_index_find(time_t start_time, time_t end_time,
+					   bool advance, bool skip_full,
+					   int *resv_cnt)
+{
+	resv_index_ent_t **match;
+	slurmctld_resv_t **resv_array;
+	int i, match_cnt = 0;
+
+	_resv_index_ready(advance);
+
+	match = xmalloc(sizeof(resv_index_ent_t *) *
+			(resv_index_cnt + resv_full_cnt + resv_float_cnt + 1));
+	_resv_index_search(resv_index, 0, resv_index_cnt, start_time, end_time,
+			   match, &match_cnt);
+	if (!skip_full) {
+		_resv_index_search(resv_full, 0, resv_full_cnt, start_time,
+				   end_time, match, &match_cnt);
+	}
+	for (i = 0; i < resv_float_cnt; i++)
+		match[match_cnt++] = &resv_float[i];
+	if (match_cnt > 1)
+		qsort(match, match_cnt, sizeof(resv_index_ent_t *),
+		      _cmp_resv_index_inx);
+
+	resv_array = xmalloc(sizeof(slurmctld_resv_t *) * (match_cnt + 1));
+	for (i = 0; i < match_cnt; i++)
+		resv_array[i] = match[i]->resv_ptr;
+	xfree(match);
+
+	*resv_cnt = match_cnt;
+	return resv_array;
+}
+
+/* End of the _resv_index_find() window for a job ending at end_time */
+static time_t _resv_index_end(time_t end_time, bool reboot)
+{
+	if (reboot)
+		end_time += node_features_g_boot_time();
+	return end_time;
+}
+
 /*
  * Test if a new/updated reservation request will overlap running jobs
  * Ignore jobs already running in that specific reservation
@@ -1820,20 +2051,24 @@ static bool _resv_overlap(time_t start_time, time_t end_time,
 			  uint32_t flags, bitstr_t *node_bitmap,
 			  slurmctld_resv_t *this_resv_ptr)
 {
-	ListIterator iter;
-	slurmctld_resv_t *resv_ptr;
+	slurmctld_resv_t *resv_ptr, **resv_array;
 	bool rc = false;
-	int i, j;
-	time_t s_time1, s_time2, e_time1, e_time2;
+	int i, j, k, resv_cnt;
+	time_t s_time1, s_time2, e_time1, e_time2, end_window;
 
 	if ((flags & RESERVE_FLAG_MAINT)   ||
 	    (flags & RESERVE_FLAG_OVERLAP) ||
 	    (!node_bitmap))
 		return rc;
 
-	iter = list_iterator_create(resv_list);
+	end_window = end_time;
+	if (flags & RESERVE_FLAG_DAILY)
+		end_window += 8 * 24 * 60 * 60;
+	resv_array = _resv_index_find(start_time, end_window, false, false,
+				      &resv_cnt);
 
-	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+	for (k = 0; k < resv_cnt; k++) {
+		resv_ptr = resv_array[k];
 		if (resv_ptr == this_resv_ptr)
 			continue;	/* skip self */
 		if (resv_ptr->node_bitmap == NULL)
@@ -1870,7 +2105,7 @@ static bool _resv_overlap(time_t start_time, time_t end_time,
 				break;
 		}
 	}
-	list_iterator_destroy(iter);
+	xfree(resv_array);
 
 	return rc;
 }
@@ -2365,6 +2600,7 @@ extern int create_resv(resv_desc_msg_t *resv_desc_ptr)
 	_set_tres_cnt(resv_ptr, NULL);
 
 	list_append(resv_list, resv_ptr);
+	resv_index_valid = false;
 	last_resv_update = now;
 	schedule_resv_save();
 
@@ -2385,6 +2621,12 @@ extern int create_resv(resv_desc_msg_t *resv_desc_ptr)
 extern void resv_fini(void)
 {
 	FREE_NULL_LIST(resv_list);
+	xfree(resv_index);
+	xfree(resv_float);
+	xfree(resv_full);
+	resv_index_cnt = 0;
+	resv_float_cnt = 0;
+	resv_full_cnt = 0;
 }
 
 /* Update an exiting resource reservation */
@@ -2652,6 +2894,8 @@ extern int update_resv(resv_desc_msg_t *resv_desc_ptr)
 		if (resv_ptr->end_time < now)
 			resv_ptr->end_time = now;
 	}
+	/* The index holds the old times, rebuild it before _resv_overlap() */
+	resv_index_valid = false;
 
 	if (resv_ptr->start_time >= resv_ptr->end_time) {
 		info("Reservation %s request has invalid times (start > end)",
@@ -2759,6 +3003,8 @@ extern int update_resv(resv_desc_msg_t *resv_desc_ptr)
 	_set_tres_cnt(resv_ptr, resv_backup);
 
 	_del_resv_rec(resv_backup);
+	/* Flag, node and license changes move it in or out of resv_full */
+	resv_index_valid = false;
 	(void) set_node_maint_mode(true);
 	last_resv_update = now;
 	schedule_resv_save();
@@ -3263,6 +3509,8 @@ static void _validate_all_reservations(void)
 		}
 	}
 	list_iterator_destroy(iter);
+	/* Licenses were revalidated, which changes _resv_full_node() */
+	resv_index_valid = false;
 
 	/* Validate all job reservation pointers */
 	iter = list_iterator_create(job_list);
@@ -3525,6 +3773,7 @@ extern int load_all_resv_state(int recover)
 			break;
 
 		list_append(resv_list, resv_ptr);
+		resv_index_valid = false;
 		info("Recovered state of reservation %s", resv_ptr->name);
 	}
 
@@ -4618,11 +4867,11 @@ static void _update_bb_resv(burst_buffer_info_msg_t **bb_resv, char *bb_spec)
 extern burst_buffer_info_msg_t *job_test_bb_resv(struct job_record *job_ptr,
 						 time_t when, bool reboot)
 {
-	slurmctld_resv_t * resv_ptr;
-	time_t job_start_time, job_end_time, now = time(NULL);
+	slurmctld_resv_t *resv_ptr, **resv_array;
+	time_t job_start_time, job_end_time;
 	time_t job_end_time_use;
 	burst_buffer_info_msg_t *bb_resv = NULL;
-	ListIterator iter;
+	int i, resv_cnt;
 
 	if ((job_ptr->burst_buffer == NULL) ||
 	    (job_ptr->burst_buffer[0] == '\0'))
@@ -4630,11 +4879,11 @@ extern burst_buffer_info_msg_t *job_test_bb_resv(struct job_record *job_ptr,
 
 	job_start_time = when;
 	job_end_time   = when + _get_job_duration(job_ptr, reboot);
-	iter = list_iterator_create(resv_list);
-	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
-		if (resv_ptr->end_time <= now)
-			_advance_resv_time(resv_ptr);
-
+	resv_array = _resv_index_find(job_start_time,
+				      _resv_index_end(job_end_time, reboot),
+				      true, false, &resv_cnt);
+	for (i = 0; i < resv_cnt; i++) {
+		resv_ptr = resv_array[i];
 		if (reboot)
 			job_end_time_use =
 				job_end_time + resv_ptr->boot_time;
@@ -4652,7 +4901,7 @@ extern burst_buffer_info_msg_t *job_test_bb_resv(struct job_record *job_ptr,
 
 		_update_bb_resv(&bb_resv, resv_ptr->burst_buffer);
 	}
-	list_iterator_destroy(iter);
+	xfree(resv_array);
 
 	return bb_resv;
 }
@@ -4670,19 +4919,18 @@ extern burst_buffer_info_msg_t *job_test_bb_resv(struct job_record *job_ptr,
 extern int job_test_lic_resv(struct job_record *job_ptr, char *lic_name,
 			     time_t when, bool reboot)
 {
-	slurmctld_resv_t * resv_ptr;
-	time_t job_start_time, job_end_time, now = time(NULL);
+	slurmctld_resv_t *resv_ptr, **resv_array;
+	time_t job_start_time, job_end_time;
 	time_t job_end_time_use;
-	ListIterator iter;
-	int resv_cnt = 0;
+	int i, match_cnt, resv_cnt = 0;
 
 	job_start_time = when;
 	job_end_time   = when + _get_job_duration(job_ptr, reboot);
-	iter = list_iterator_create(resv_list);
-	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
-		if (resv_ptr->end_time <= now)
-			_advance_resv_time(resv_ptr);
-
+	resv_array = _resv_index_find(job_start_time,
+				      _resv_index_end(job_end_time, reboot),
+				      true, false, &match_cnt);
+	for (i = 0; i < match_cnt; i++) {
+		resv_ptr = resv_array[i];
 		if (reboot)
 			job_end_time_use =
 				job_end_time + resv_ptr->boot_time;
@@ -4699,7 +4947,7 @@ extern int job_test_lic_resv(struct job_record *job_ptr, char *lic_name,
 
 		resv_cnt += _license_cnt(resv_ptr->license_list, lic_name);
 	}
-	list_iterator_destroy(iter);
+	xfree(resv_array);
 
 	/* info("%pJ blocked from %d licenses of type %s",
 	     job_ptr, resv_cnt, lic_name); */
@@ -4952,6 +5200,8 @@ extern uint32_t job_test_watts_resv(struct job_record *job_ptr, time_t when,
  *		      overlap with an advanced reservation, indicates that
  *		      resources were removed from availability to the job
  * IN reboot    - true if node reboot required to start job
+ * IN skip_full - if job has no reservation, ignore the reservations returned
+ *		  by resv_full_node_spans()
  * RET	SLURM_SUCCESS if runable now
  *	ESLURM_RESERVATION_ACCESS access to reservation denied
  *	ESLURM_RESERVATION_INVALID reservation invalid
@@ -4961,17 +5211,16 @@ extern uint32_t job_test_watts_resv(struct job_record *job_ptr, time_t when,
  *	ESLURM_RESERVATION_MAINT job has no reservation, but required nodes are
  *				 in maintenance reservation
  */
-extern int job_test_resv(struct job_record *job_ptr, time_t *when,
-			 bool move_time, bitstr_t **node_bitmap,
-			 bitstr_t **exc_core_bitmap, bool *resv_overlap,
-			 bool reboot)
+static int _job_test_resv(struct job_record *job_ptr, time_t *when,
+			  bool move_time, bitstr_t **node_bitmap,
+			  bitstr_t **exc_core_bitmap, bool *resv_overlap,
+			  bool reboot, bool skip_full)
 {
-	slurmctld_resv_t *resv_ptr = NULL, *res2_ptr;
+	slurmctld_resv_t *resv_ptr = NULL, *res2_ptr, **resv_array;
 	time_t job_start_time, job_end_time, job_end_time_use, lic_resv_time;
 	time_t start_relative, end_relative;
 	time_t now = time(NULL);
-	ListIterator iter;
-	int i, rc = SLURM_SUCCESS, rc2;
+	int i, j, rc = SLURM_SUCCESS, rc2, resv_cnt;
 
 	*resv_overlap = false;	/* initialize to false */
 	job_start_time = *when;
@@ -5044,8 +5293,12 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 		 * if there are any overlapping reservations, we need to
 		 * prevent the job from using those nodes (e.g. MAINT nodes)
 		 */
-		iter = list_iterator_create(resv_list);
-		while ((res2_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		resv_array = _resv_index_find(job_start_time,
+					      _resv_index_end(job_end_time,
+							      reboot),
+					      false, false, &resv_cnt);
+		for (j = 0; j < resv_cnt; j++) {
+			res2_ptr = resv_array[j];
 			if (reboot)
 				job_end_time_use =
 					job_end_time + res2_ptr->boot_time;
@@ -5066,7 +5319,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				bit_and_not(*node_bitmap,res2_ptr->node_bitmap);
 			}
 		}
-		list_iterator_destroy(iter);
+		xfree(resv_array);
 
 		if (slurmctld_conf.debug_flags & DEBUG_FLAG_RESERVATION) {
 			char *nodes = bitmap2node_name(*node_bitmap);
@@ -5100,8 +5353,12 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 	for (i = 0; ; i++) {
 		lic_resv_time = (time_t) 0;
 
-		iter = list_iterator_create(resv_list);
-		while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		resv_array = _resv_index_find(job_start_time,
+					      _resv_index_end(job_end_time,
+							      reboot),
+					      true, skip_full, &resv_cnt);
+		for (j = 0; j < resv_cnt; j++) {
+			resv_ptr = resv_array[j];
 			if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT) {
 				start_relative = resv_ptr->start_time + now;
 				if (resv_ptr->duration == INFINITE)
@@ -5117,8 +5374,6 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 						start_relative = end_relative;
 				}
 			} else {
-				if (resv_ptr->end_time <= now)
-					_advance_resv_time(resv_ptr);
 				start_relative = resv_ptr->start_time_first;
 				end_relative = resv_ptr->end_time;
 			}
@@ -5198,7 +5453,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				continue;
 			}
 		}
-		list_iterator_destroy(iter);
+		xfree(resv_array);
 
 		if ((rc == SLURM_SUCCESS) && move_time) {
 			if (license_job_test(job_ptr, job_start_time, reboot)
@@ -5233,6 +5488,58 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 	return rc;
 }
 
+extern int job_test_resv(struct job_record *job_ptr, time_t *when,
+			 bool move_time, bitstr_t **node_bitmap,
+			 bitstr_t **exc_core_bitmap, bool *resv_overlap,
+			 bool reboot)
+{
+	return _job_test_resv(job_ptr, when, move_time, node_bitmap,
+			      exc_core_bitmap, resv_overlap, reboot, false);
+}
+
+extern int job_test_resv_skip_full(struct job_record *job_ptr, time_t *when,
+				   bool move_time, bitstr_t **node_bitmap,
+				   bitstr_t **exc_core_bitmap,
+				   bool *resv_overlap)
+{
+	xassert(!job_ptr->resv_name);
+	xassert(!job_ptr->details->req_node_bitmap);
+
+	return _job_test_resv(job_ptr, when, move_time, node_bitmap,
+			      exc_core_bitmap, resv_overlap, false, true);
+}
+
+extern resv_node_span_t *resv_full_node_spans(time_t start_time,
+					      time_t end_time, int *span_cnt)
+{
+	resv_index_ent_t **match;
+	resv_node_span_t *spans;
+	slurmctld_resv_t *resv_ptr;
+	int i, match_cnt = 0;
+
+	*span_cnt = 0;
+	_resv_index_ready(true);
+
+	match = xmalloc(sizeof(resv_index_ent_t *) * (resv_full_cnt + 1));
+	_resv_index_search(resv_full, 0, resv_full_cnt, start_time, end_time,
+			   match, &match_cnt);
+	spans = xmalloc(sizeof(resv_node_span_t) * (match_cnt + 1));
+	for (i = 0; i < match_cnt; i++) {
+		resv_ptr = match[i]->resv_ptr;
+		if ((resv_ptr->start_time_first >= end_time) ||
+		    (resv_ptr->end_time <= start_time) ||
+		    (resv_ptr->start_time_first >= resv_ptr->end_time))
+			continue;
+		spans[*span_cnt].start_time = resv_ptr->start_time_first;
+		spans[*span_cnt].end_time = resv_ptr->end_time;
+		spans[*span_cnt].node_bitmap = resv_ptr->node_bitmap;
+		(*span_cnt)++;
+	}
+	xfree(match);
+
+	return spans;
+}
+
 /*
  * Determine the time of the first reservation to end after some time.
  * return zero of no reservation ends after that time.
@@ -5389,6 +5696,7 @@ static void _advance_resv_time(slurmctld_resv_t *resv_ptr)
 		resv_ptr->start_time_prev = resv_ptr->start_time;
 		resv_ptr->start_time_first = resv_ptr->start_time;
 		_advance_time(&resv_ptr->end_time, day_cnt);
+		resv_index_valid = false;
 		_post_resv_create(resv_ptr);
 		last_resv_update = time(NULL);
 		schedule_resv_save();
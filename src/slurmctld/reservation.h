@@ -176,6 +176,36 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			 bitstr_t **exc_core_bitmap, bool *resv_overlap,
 			 bool reboot);
 
+/* Time span of a reservation's nodes, see resv_full_node_spans() */
+typedef struct resv_node_span {
+	time_t end_time;
+	bitstr_t *node_bitmap;	/* the reservation's own, do not free */
+	time_t start_time;
+} resv_node_span_t;
+
+/*
+ * Find the reservations of full nodes with a fixed, non-repeating start time
+ *	and no licenses which overlap [start_time, end_time). For jobs without
+ *	a reservation such reservations only remove their nodes, so callers
+ *	testing many jobs may track those nodes over time themselves and use
+ *	job_test_resv_skip_full(). The node_bitmap pointers are only valid
+ *	until reservations change (last_resv_update).
+ * OUT span_cnt - number of spans returned
+ * RET array of spans, xfree the array (not the bitmaps)
+ */
+extern resv_node_span_t *resv_full_node_spans(time_t start_time,
+					      time_t end_time, int *span_cnt);
+
+/*
+ * Same as job_test_resv() without node reboot, but ignore the reservations
+ *	returned by resv_full_node_spans(). Only for jobs without a reservation
+ *	or required nodes, the caller must remove those reservations' nodes.
+ */
+extern int job_test_resv_skip_full(struct job_record *job_ptr, time_t *when,
+				   bool move_time, bitstr_t **node_bitmap,
+				   bitstr_t **exc_core_bitmap,
+				   bool *resv_overlap);
+
 /*
  * Note that a job is starting execution. If that job is associated with a
  * reservation having the "Refresh" flag, then remove that job's nodes from
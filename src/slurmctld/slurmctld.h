@@ -100,7 +100,7 @@
 #define PURGE_JOB_INTERVAL 60
 #endif
 
-/* Process pending trigger events every TRIGGER_INTERVAL seconds */
+/* Test time based triggers every TRIGGER_INTERVAL seconds */
 #ifndef TRIGGER_INTERVAL
 #define TRIGGER_INTERVAL 15
 #endif
@@ -194,6 +194,11 @@ typedef struct diag_stats {
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
 
+	uint32_t preempt_events;
+	uint32_t preempt_jobs;
+	uint64_t preempt_cpu_secs;
+	uint32_t preempt_spared;
+
 	uint32_t latency;
 } diag_stats_t;
 
@@ -512,7 +517,12 @@ struct job_details {
 	uint16_t cpus_per_task;		/* number of processors required for
 					 * each task */
 	uint16_t orig_cpus_per_task;	/* requested value of cpus_per_task */
+	bool depend_clean;		/* depend_list tested and no parent
+					 * job changed state since */
+	uint32_t depend_gen;		/* generation of this job's edges in
+					 * the dependency graph */
 	List depend_list;		/* list of job_ptr:state pairs */
+	uint32_t depend_scan;		/* _scan_depend() visit stamp */
 	char *dependency;		/* wait for other jobs */
 	char *orig_dependency;		/* original value (for archiving) */
 	uint16_t env_cnt;		/* size of env_sup (see below) */
@@ -553,6 +563,8 @@ struct job_details {
 	uint32_t reserved_resources;	/* CPU minutes of resources reserved
 					 * for this job while it was pending */
 	bitstr_t *req_node_bitmap;	/* bitmap of required nodes */
+	uint32_t preempt_spared;	/* preemptees spared by the last node
+					 * selection for this job */
 	time_t preempt_start_time;	/* time that preeption began to start
 					 * this job */
 	char *req_nodes;		/* required nodes */
@@ -762,6 +774,8 @@ struct job_record {
 	uint8_t power_flags;		/* power management flags,
 					 * see SLURM_POWER_FLAGS_ */
 	time_t pre_sus_time;		/* time job ran prior to last suspend */
+	uint32_t preempt_cand_inx;	/* position in preemption candidate
+					 * array, see preempt_cand_add() */
 	time_t preempt_time;		/* job preemption signal time */
 	bool preempt_in_progress;	/* Premption of other jobs in progress
 					 * in order to start this job,
@@ -1978,6 +1992,12 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid,
 			   uint16_t protocol_version);
 
+/*
+ * Refresh the cached resource fragmentation statistics reported by sdiag
+ * NOTE: Caller must hold config read, node write and partition read locks.
+ */
+extern void update_frag_stats(void);
+
 /* Pack all scheduling statistics */
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version);
@@ -37,16 +37,103 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <string.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
+#include "src/common/node_select.h"
 #include "src/common/pack.h"
+#include "src/common/slurm_topology.h"
 #include "src/common/xstring.h"
 #include "src/common/slurmdbd_defs.h"
 
+typedef struct {
+	uint32_t idle_nodes;		/* available nodes with no jobs */
+	uint32_t mixed_nodes;		/* nodes partially allocated */
+	uint32_t idle_cpus;		/* unallocated CPUs on usable nodes */
+	uint32_t mixed_idle_cpus;	/* unallocated CPUs on mixed nodes */
+	uint32_t leaf_switches;		/* leaf switch count */
+	uint32_t idle_leaf_switches;	/* leaf switches with all nodes idle */
+} frag_stats_t;
+
+static frag_stats_t frag_stats_cache;
+static time_t frag_stats_node_update = (time_t) 0;
+static pthread_mutex_t frag_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 extern int retry_list_size(void);
 
+/*
+ * Gather resource fragmentation statistics: how many unallocated CPUs are
+ * stranded on partially allocated nodes and how many leaf switches remain
+ * entirely idle. Called from the scheduling loop so that sdiag requests
+ * only copy the cached values rather than contending for the node lock.
+ * Nothing is done unless nodes changed since the last call.
+ * NOTE: Caller must hold config read, node write and partition read locks.
+ */
+extern void update_frag_stats(void)
+{
+	frag_stats_t frag_stats;
+	struct node_record *node_ptr;
+	uint16_t cpus_total, cpus_used;
+	bitstr_t *usable_node_bitmap;
+	int i;
+
+	if (!avail_node_bitmap || !idle_node_bitmap ||
+	    (frag_stats_node_update == last_node_update))
+		return;
+	frag_stats_node_update = last_node_update;
+
+	memset(&frag_stats, 0, sizeof(frag_stats_t));
+	select_g_select_nodeinfo_set_all();
+	usable_node_bitmap = bit_copy(avail_node_bitmap);
+	for (i = 0, node_ptr = node_record_table_ptr; i < node_record_count;
+	     i++, node_ptr++) {
+		if (!bit_test(usable_node_bitmap, i))
+			continue;
+		if (IS_NODE_FUTURE(node_ptr) || IS_NODE_POWER_SAVE(node_ptr)) {
+			bit_clear(usable_node_bitmap, i);
+			continue;
+		}
+		if (slurmctld_conf.fast_schedule)
+			cpus_total = node_ptr->config_ptr->cpus;
+		else
+			cpus_total = node_ptr->cpus;
+		cpus_used = 0;
+		if (!bit_test(idle_node_bitmap, i)) {
+			select_g_select_nodeinfo_get(node_ptr->select_nodeinfo,
+						     SELECT_NODEDATA_SUBCNT,
+						     NODE_STATE_ALLOCATED,
+						     &cpus_used);
+		}
+		if (cpus_used >= cpus_total)
+			continue;
+		frag_stats.idle_cpus += cpus_total - cpus_used;
+		if (cpus_used == 0) {
+			frag_stats.idle_nodes++;
+		} else {
+			frag_stats.mixed_nodes++;
+			frag_stats.mixed_idle_cpus += cpus_total - cpus_used;
+		}
+	}
+	bit_and(usable_node_bitmap, idle_node_bitmap);
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (switch_record_table[i].level != 0)
+			continue;
+		frag_stats.leaf_switches++;
+		if (bit_super_set(switch_record_table[i].node_bitmap,
+				  usable_node_bitmap))
+			frag_stats.idle_leaf_switches++;
+	}
+	FREE_NULL_BITMAP(usable_node_bitmap);
+
+	slurm_mutex_lock(&frag_stats_mutex);
+	frag_stats_cache = frag_stats;
+	slurm_mutex_unlock(&frag_stats_mutex);
+}
+
 /* Pack all scheduling statistics */
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version)
@@ -58,6 +145,7 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	int slurmdbd_queue_size;
 	time_t now = time(NULL);
 	uint32_t uint32_tmp;
+	frag_stats_t frag_stats;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
@@ -71,7 +159,86 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	}
 
 	buffer = init_buf(BUF_SIZE);
-	if (protocol_version >= SLURM_18_08_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_19_05_PROTOCOL_VERSION) {
+		parts_packed = resp;
+		pack32(parts_packed, buffer);
+
+		if (resp) {
+			pack_time(now, buffer);
+			debug3("pack_all_stat: time = %u",
+			       (uint32_t) last_proc_req_start);
+			pack_time(last_proc_req_start, buffer);
+
+			debug3("pack_all_stat: server_thread_count = %u",
+			       slurmctld_config.server_thread_count);
+			pack32(slurmctld_config.server_thread_count, buffer);
+
+			agent_queue_size = retry_list_size();
+			pack32(agent_queue_size, buffer);
+			agent_count = get_agent_count();
+			pack32(agent_count, buffer);
+			pack32(slurmdbd_queue_size, buffer);
+			pack32(slurmctld_diag_stats.latency, buffer);
+
+			pack32(slurmctld_diag_stats.jobs_submitted, buffer);
+			pack32(slurmctld_diag_stats.jobs_started, buffer);
+			pack32(slurmctld_diag_stats.jobs_completed, buffer);
+			pack32(slurmctld_diag_stats.jobs_canceled, buffer);
+			pack32(slurmctld_diag_stats.jobs_failed, buffer);
+
+			pack32(slurmctld_diag_stats.jobs_pending, buffer);
+			pack32(slurmctld_diag_stats.jobs_running, buffer);
+			pack_time(slurmctld_diag_stats.job_states_ts, buffer);
+
+			pack32(slurmctld_diag_stats.schedule_cycle_max,
+			       buffer);
+			pack32(slurmctld_diag_stats.schedule_cycle_last,
+			       buffer);
+			pack32(slurmctld_diag_stats.schedule_cycle_sum,
+			       buffer);
+			pack32(slurmctld_diag_stats.schedule_cycle_counter,
+			       buffer);
+			pack32(slurmctld_diag_stats.schedule_cycle_depth,
+			       buffer);
+			pack32(slurmctld_diag_stats.schedule_queue_len, buffer);
+
+			pack32(slurmctld_diag_stats.backfilled_jobs, buffer);
+			pack32(slurmctld_diag_stats.last_backfilled_jobs,
+			       buffer);
+			pack32(slurmctld_diag_stats.bf_cycle_counter, buffer);
+			pack64(slurmctld_diag_stats.bf_cycle_sum, buffer);
+			pack32(slurmctld_diag_stats.bf_cycle_last, buffer);
+			pack32(slurmctld_diag_stats.bf_last_depth, buffer);
+			pack32(slurmctld_diag_stats.bf_last_depth_try, buffer);
+
+			pack32(slurmctld_diag_stats.bf_queue_len, buffer);
+			pack32(slurmctld_diag_stats.bf_cycle_max, buffer);
+			pack_time(slurmctld_diag_stats.bf_when_last_cycle,
+				  buffer);
+			pack32(slurmctld_diag_stats.bf_depth_sum, buffer);
+			pack32(slurmctld_diag_stats.bf_depth_try_sum, buffer);
+			pack32(slurmctld_diag_stats.bf_queue_len_sum, buffer);
+
+			pack32(slurmctld_diag_stats.bf_active, buffer);
+			pack32(slurmctld_diag_stats.backfilled_pack_jobs,
+			       buffer);
+
+			slurm_mutex_lock(&frag_stats_mutex);
+			frag_stats = frag_stats_cache;
+			slurm_mutex_unlock(&frag_stats_mutex);
+			pack32(frag_stats.idle_nodes, buffer);
+			pack32(frag_stats.mixed_nodes, buffer);
+			pack32(frag_stats.idle_cpus, buffer);
+			pack32(frag_stats.mixed_idle_cpus, buffer);
+			pack32(frag_stats.leaf_switches, buffer);
+			pack32(frag_stats.idle_leaf_switches, buffer);
+
+			pack32(slurmctld_diag_stats.preempt_events, buffer);
+			pack32(slurmctld_diag_stats.preempt_jobs, buffer);
+			pack64(slurmctld_diag_stats.preempt_cpu_secs, buffer);
+			pack32(slurmctld_diag_stats.preempt_spared, buffer);
+		}
+	} else if (protocol_version >= SLURM_18_08_PROTOCOL_VERSION) {
 		parts_packed = resp;
 		pack32(parts_packed, buffer);
 
@@ -236,6 +403,10 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.preempt_events = 0;
+	slurmctld_diag_stats.preempt_jobs = 0;
+	slurmctld_diag_stats.preempt_cpu_secs = 0;
+	slurmctld_diag_stats.preempt_spared = 0;
 
 	last_proc_req_start = time(NULL);
 }
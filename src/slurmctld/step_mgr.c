@@ -108,6 +108,7 @@ static hostlist_t _step_range_to_hostlist(struct step_record *step_ptr,
 static int _step_hostname_to_inx(struct step_record *step_ptr,
 				char *node_name);
 static void _step_dealloc_lps(struct step_record *step_ptr);
+static void _update_steps_per_node(struct step_record *step_ptr, int delta);
 
 /* Determine how many more CPUs are required for a job step */
 static int  _opt_cpu_cnt(uint32_t step_min_cpus, bitstr_t *node_bitmap,
@@ -371,6 +372,68 @@ extern void step_list_purge(struct job_record *job_ptr)
 	FREE_NULL_LIST(job_ptr->step_list);
 }
 
+/*
+ * Add (delta > 0) or remove (delta < 0) an active step from its job's count
+ * of active steps per node. Nothing is done until the counts have been built
+ * by _build_steps_per_node(), so this costs only O(nodes in step).
+ */
+static void _update_steps_per_node(struct step_record *step_ptr, int delta)
+{
+	job_resources_t *job_resrcs_ptr = step_ptr->job_ptr->job_resrcs;
+	int i, i_first, i_last, job_node_inx;
+
+	if (!job_resrcs_ptr || !job_resrcs_ptr->steps_per_node ||
+	    !job_resrcs_ptr->node_bitmap || !step_ptr->step_node_bitmap ||
+	    (step_ptr->state < JOB_RUNNING))
+		return;
+
+	i_first = bit_ffs(step_ptr->step_node_bitmap);
+	if (i_first == -1)
+		return;
+	i_last = MIN(bit_fls(step_ptr->step_node_bitmap),
+		     bit_fls(job_resrcs_ptr->node_bitmap));
+	job_node_inx = bit_set_count_range(job_resrcs_ptr->node_bitmap, 0,
+					   i_first) - 1;
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(job_resrcs_ptr->node_bitmap, i))
+			continue;
+		job_node_inx++;
+		if (!bit_test(step_ptr->step_node_bitmap, i))
+			continue;
+		if (job_node_inx >= job_resrcs_ptr->nhosts)
+			break;
+		if (delta > 0) {
+			job_resrcs_ptr->steps_per_node[job_node_inx]++;
+		} else if (job_resrcs_ptr->steps_per_node[job_node_inx]) {
+			job_resrcs_ptr->steps_per_node[job_node_inx]--;
+		} else {
+			error("%s: step count underflow for %pS on job node %d",
+			      __func__, step_ptr, job_node_inx);
+		}
+	}
+}
+
+/*
+ * Build a job's count of active steps per node from its step list. The
+ * counts are then maintained as steps are created and purged, so picking
+ * idle nodes for a new step no longer needs to walk every existing step.
+ */
+static void _build_steps_per_node(struct job_record *job_ptr)
+{
+	job_resources_t *job_resrcs_ptr = job_ptr->job_resrcs;
+	ListIterator step_iterator;
+	struct step_record *step_ptr;
+
+	if (job_resrcs_ptr->steps_per_node)
+		return;
+	job_resrcs_ptr->steps_per_node = xmalloc(sizeof(uint32_t) *
+						 job_resrcs_ptr->nhosts);
+	step_iterator = list_iterator_create(job_ptr->step_list);
+	while ((step_ptr = (struct step_record *) list_next(step_iterator)))
+		_update_steps_per_node(step_ptr, 1);
+	list_iterator_destroy(step_iterator);
+}
+
 /* _free_step_rec - delete a step record's data structures */
 static void _free_step_rec(struct step_record *step_ptr)
 {
@@ -397,6 +460,7 @@ static void _free_step_rec(struct step_record *step_ptr)
 	jobacctinfo_destroy(step_ptr->jobacct);
 	FREE_NULL_BITMAP(step_ptr->core_bitmap_job);
 	FREE_NULL_BITMAP(step_ptr->exit_node_bitmap);
+	_update_steps_per_node(step_ptr, -1);
 	FREE_NULL_BITMAP(step_ptr->step_node_bitmap);
 	xfree(step_ptr->resv_port_array);
 	xfree(step_ptr->resv_ports);
@@ -1566,24 +1630,36 @@ _pick_step_nodes (struct job_record *job_ptr,
 		FREE_NULL_BITMAP(relative_nodes);
 	} else {
 		nodes_idle = bit_alloc (bit_size (nodes_avail) );
-		step_iterator = list_iterator_create(job_ptr->step_list);
-		while ((step_ptr = (struct step_record *)
-			list_next(step_iterator))) {
-			if (step_ptr->state < JOB_RUNNING)
+		_build_steps_per_node(job_ptr);
+		first_bit = bit_ffs(job_resrcs_ptr->node_bitmap);
+		if (first_bit >= 0)
+			last_bit  = bit_fls(job_resrcs_ptr->node_bitmap);
+		else
+			last_bit = -2;
+		for (i = first_bit, node_inx = -1; i <= last_bit; i++) {
+			if (!bit_test(job_resrcs_ptr->node_bitmap, i))
 				continue;
-			bit_or(nodes_idle, step_ptr->step_node_bitmap);
-			if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
+			node_inx++;
+			if (job_resrcs_ptr->steps_per_node[node_inx] == 0)
+				bit_set(nodes_idle, i);
+		}
+		bit_and(nodes_idle, nodes_avail);
+		if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
+			step_iterator = list_iterator_create(
+						job_ptr->step_list);
+			while ((step_ptr = (struct step_record *)
+				list_next(step_iterator))) {
 				char *temp;
+				if (step_ptr->state < JOB_RUNNING)
+					continue;
 				temp = bitmap2node_name(step_ptr->
 							step_node_bitmap);
 				info("%s: %pS has nodes %s", __func__,
 				     step_ptr, temp);
 				xfree(temp);
 			}
+			list_iterator_destroy (step_iterator);
 		}
-		list_iterator_destroy (step_iterator);
-		bit_not(nodes_idle);
-		bit_and(nodes_idle, nodes_avail);
 	}
 
 	if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
@@ -2645,6 +2721,7 @@ step_create(job_step_create_request_msg_t *step_specs,
 			step_node_list, step_specs->node_list);
 	}
 	step_ptr->step_node_bitmap = nodeset;
+	_update_steps_per_node(step_ptr, 1);
 
 	switch (step_specs->task_dist & SLURM_DIST_NODESOCKMASK) {
 	case SLURM_DIST_CYCLIC:
@@ -4732,6 +4809,9 @@ extern void rebuild_step_bitmaps(struct job_record *job_ptr,
 	if (job_ptr->step_list == NULL)
 		return;
 
+	/* Job node indexes changed, rebuild step counts on demand */
+	xfree(job_ptr->job_resrcs->steps_per_node);
+
 	step_iterator = list_iterator_create(job_ptr->step_list);
 	while ((step_ptr = (struct step_record *)
 			   list_next (step_iterator))) {
@@ -4835,6 +4915,7 @@ extern struct step_record *build_extern_step(struct job_record *job_ptr)
 	if (job_ptr->node_bitmap)
 		step_ptr->step_node_bitmap =
 			bit_copy(job_ptr->node_bitmap);
+	_update_steps_per_node(step_ptr, 1);
 	step_ptr->time_last_active = time(NULL);
 	step_set_alloc_tres(step_ptr, 1, false, false);
 
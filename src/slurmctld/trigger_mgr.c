@@ -64,6 +64,12 @@
 #include "src/slurmctld/trigger_mgr.h"
 
 #define MAX_PROG_TIME 300	/* maximum run time for program */
+#define MAX_PROG_CNT 64		/* maximum trigger programs run at once */
+#define TRIG_SUB_CNT 21		/* TRIGGER_TYPE_* bits with subscriptions */
+
+/* Trigger types tested on every periodic pass rather than on an event */
+#define TRIGGER_TYPE_TIMED (TRIGGER_TYPE_TIME | TRIGGER_TYPE_IDLE | \
+			    TRIGGER_TYPE_FINI)
 
 /* Change TRIGGER_STATE_VERSION value when changing the state save format */
 #define TRIGGER_STATE_VERSION        "PROTOCOL_VERSION"
@@ -91,6 +97,18 @@ static bool trigger_pri_dbd_res_op = false;
 static bool trigger_pri_db_fail = false;
 static bool trigger_pri_db_res_op = false;
 
+/*
+ * Pending triggers (state 0) are subscribed to each event of _trig_sub_mask(),
+ * trig_sub_list[i] holding those with bit i set. Other triggers are kept in
+ * trig_active_list until purged. Both reference records in trigger_list.
+ */
+static List trig_sub_list[TRIG_SUB_CNT];
+static List trig_active_list = NULL;
+static uint32_t trigger_events = 0;	/* TRIGGER_TYPE_* noted since last
+					 * trigger_process() */
+static time_t trig_next_time = 0;	/* when a pulled trigger is due */
+static int trig_prog_cnt = 0;		/* trigger programs running */
+
 /* Current trigger pull states (saved and restored) */
 uint8_t ctld_failure = 0;
 uint8_t bu_ctld_failure = 0;
@@ -130,6 +148,81 @@ void _trig_del(void *x) {
 	xfree(tmp);
 }
 
+static int _find_trig_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+/*
+ * Events a pending trigger is tested on. Job triggers are also tested on
+ * every job completion and periodic pass, so that triggers for purged jobs
+ * are removed whatever their trigger type.
+ */
+static uint32_t _trig_sub_mask(trig_mgr_info_t *trig_ptr)
+{
+	if (trig_ptr->res_type == TRIGGER_RES_TYPE_JOB)
+		return (trig_ptr->trig_type | TRIGGER_TYPE_FINI);
+	return trig_ptr->trig_type;
+}
+
+/* Add a trigger to the subscription tables or active list per its state.
+ * Call with trigger_mutex locked. */
+static void _trig_subscribe(trig_mgr_info_t *trig_ptr)
+{
+	uint32_t sub_mask;
+	int i;
+
+	if (trig_ptr->state != 0) {
+		if (!trig_active_list)
+			trig_active_list = list_create(NULL);
+		list_append(trig_active_list, trig_ptr);
+		if ((trig_ptr->state == 1) &&
+		    (!trig_next_time || (trig_ptr->trig_time < trig_next_time)))
+			trig_next_time = trig_ptr->trig_time;
+		return;
+	}
+
+	sub_mask = _trig_sub_mask(trig_ptr);
+	for (i = 0; i < TRIG_SUB_CNT; i++) {
+		if (!(sub_mask & (1 << i)))
+			continue;
+		if (!trig_sub_list[i])
+			trig_sub_list[i] = list_create(NULL);
+		list_append(trig_sub_list[i], trig_ptr);
+	}
+}
+
+/* Remove a trigger from the subscription tables and active list.
+ * Call with trigger_mutex locked. */
+static void _trig_unsubscribe(trig_mgr_info_t *trig_ptr)
+{
+	uint32_t sub_mask = _trig_sub_mask(trig_ptr);
+	int i;
+
+	if (trig_active_list) {
+		(void) list_delete_all(trig_active_list, _find_trig_ptr,
+				       trig_ptr);
+	}
+	for (i = 0; i < TRIG_SUB_CNT; i++) {
+		if (!(sub_mask & (1 << i)) || !trig_sub_list[i])
+			continue;
+		(void) list_delete_all(trig_sub_list[i], _find_trig_ptr,
+				       trig_ptr);
+	}
+}
+
+/* Empty the subscription tables and active list */
+static void _trig_sub_flush(void)
+{
+	int i;
+
+	for (i = 0; i < TRIG_SUB_CNT; i++)
+		FREE_NULL_LIST(trig_sub_list[i]);
+	FREE_NULL_LIST(trig_active_list);
+	trig_next_time = 0;
+	trig_prog_cnt = 0;
+}
+
 static int _trig_offset(uint16_t offset)
 {
 	static int rc;
@@ -314,6 +407,7 @@ extern int trigger_clear(uid_t uid, trigger_info_msg_t *msg)
 			rc = ESLURM_ACCESS_DENIED;
 			continue;
 		}
+		_trig_unsubscribe(trig_test);
 		list_delete_item(trig_iter);
 		rc = SLURM_SUCCESS;
 	}
@@ -493,6 +587,7 @@ extern int trigger_set(uid_t uid, gid_t gid, trigger_info_msg_t *msg)
 			continue;
 		}
 		list_append(trigger_list, trig_add);
+		_trig_subscribe(trig_add);
 		schedule_trigger_save();
 	}
 
@@ -511,6 +606,7 @@ extern void trigger_front_end_down(front_end_record_t *front_end_ptr)
 	if (trigger_down_front_end_bitmap == NULL)
 		trigger_down_front_end_bitmap = bit_alloc(front_end_node_cnt);
 	bit_set(trigger_down_front_end_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_DOWN;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -524,6 +620,7 @@ extern void trigger_front_end_up(front_end_record_t *front_end_ptr)
 	if (trigger_up_front_end_bitmap == NULL)
 		trigger_up_front_end_bitmap = bit_alloc(front_end_node_cnt);
 	bit_set(trigger_up_front_end_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_UP;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -537,6 +634,7 @@ extern void trigger_node_down(struct node_record *node_ptr)
 	if (trigger_down_nodes_bitmap == NULL)
 		trigger_down_nodes_bitmap = bit_alloc(node_record_count);
 	bit_set(trigger_down_nodes_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_DOWN;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -550,6 +648,7 @@ extern void trigger_node_drained(struct node_record *node_ptr)
 	if (trigger_drained_nodes_bitmap == NULL)
 		trigger_drained_nodes_bitmap = bit_alloc(node_record_count);
 	bit_set(trigger_drained_nodes_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_DRAINED;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -563,6 +662,7 @@ extern void trigger_node_failing(struct node_record *node_ptr)
 	if (trigger_fail_nodes_bitmap == NULL)
 		trigger_fail_nodes_bitmap = bit_alloc(node_record_count);
 	bit_set(trigger_fail_nodes_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_FAIL;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -577,6 +677,7 @@ extern void trigger_node_up(struct node_record *node_ptr)
 	if (trigger_up_nodes_bitmap == NULL)
 		trigger_up_nodes_bitmap = bit_alloc(node_record_count);
 	bit_set(trigger_up_nodes_bitmap, inx);
+	trigger_events |= TRIGGER_TYPE_UP;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -587,6 +688,7 @@ extern void trigger_reconfig(void)
 	lock_slurmctld(node_read_lock);
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_node_reconfig = true;
+	trigger_events |= TRIGGER_TYPE_RECONFIG;
 	if (trigger_down_front_end_bitmap)
 		trigger_down_front_end_bitmap = bit_realloc(
 			trigger_down_front_end_bitmap, node_record_count);
@@ -614,6 +716,7 @@ extern void trigger_primary_ctld_fail(void)
 	slurm_mutex_lock(&trigger_mutex);
 	if (ctld_failure != 1) {
 		trigger_pri_ctld_fail = true;
+		trigger_events |= TRIGGER_TYPE_PRI_CTLD_FAIL;
 		ctld_failure = 1;
 	}
 	slurm_mutex_unlock(&trigger_mutex);
@@ -623,6 +726,7 @@ extern void trigger_primary_ctld_res_op(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_pri_ctld_res_op = true;
+	trigger_events |= TRIGGER_TYPE_PRI_CTLD_RES_OP;
 	ctld_failure = 0;
 	slurm_mutex_unlock(&trigger_mutex);
 }
@@ -631,6 +735,7 @@ extern void trigger_primary_ctld_res_ctrl(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_pri_ctld_res_ctrl = true;
+	trigger_events |= TRIGGER_TYPE_PRI_CTLD_RES_CTRL;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -638,6 +743,7 @@ extern void trigger_primary_ctld_acct_full(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_pri_ctld_acct_buffer_full = true;
+	trigger_events |= TRIGGER_TYPE_PRI_CTLD_ACCT_FULL;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -646,6 +752,7 @@ extern void trigger_backup_ctld_fail(int index)
 	slurm_mutex_lock(&trigger_mutex);
 	if (bu_ctld_failure != 1) {
 		trigger_bu_ctld_fail = true;
+		trigger_events |= TRIGGER_TYPE_BU_CTLD_FAIL;
 		bu_ctld_failure = 1;
 	}
 	slurm_mutex_unlock(&trigger_mutex);
@@ -655,6 +762,7 @@ extern void trigger_backup_ctld_res_op(int index)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_bu_ctld_res_op = true;
+	trigger_events |= TRIGGER_TYPE_BU_CTLD_RES_OP;
 	bu_ctld_failure = 0;
 	slurm_mutex_unlock(&trigger_mutex);
 }
@@ -663,6 +771,7 @@ extern void trigger_backup_ctld_as_ctrl(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_bu_ctld_as_ctrl = true;
+	trigger_events |= TRIGGER_TYPE_BU_CTLD_AS_CTRL;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -671,6 +780,7 @@ extern void trigger_primary_dbd_fail(void)
 	slurm_mutex_lock(&trigger_mutex);
 	if (dbd_failure != 1) {
 		trigger_pri_dbd_fail = true;
+		trigger_events |= TRIGGER_TYPE_PRI_DBD_FAIL;
 		dbd_failure = 1;
 	}
 	slurm_mutex_unlock(&trigger_mutex);
@@ -680,6 +790,7 @@ extern void trigger_primary_dbd_res_op(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_pri_dbd_res_op = true;
+	trigger_events |= TRIGGER_TYPE_PRI_DBD_RES_OP;
 	dbd_failure = 0;
 	slurm_mutex_unlock(&trigger_mutex);
 }
@@ -689,6 +800,7 @@ extern void trigger_primary_db_fail(void)
 	slurm_mutex_lock(&trigger_mutex);
 	if (db_failure != 1) {
 		trigger_pri_db_fail = true;
+		trigger_events |= TRIGGER_TYPE_PRI_DB_FAIL;
 		db_failure = 1;
 	}
 	slurm_mutex_unlock(&trigger_mutex);
@@ -698,14 +810,23 @@ extern void trigger_primary_db_res_op(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 		trigger_pri_db_res_op = true;
+		trigger_events |= TRIGGER_TYPE_PRI_DB_RES_OP;
 		db_failure = 0;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
+extern void trigger_job_fini(void)
+{
+	slurm_mutex_lock(&trigger_mutex);
+	trigger_events |= TRIGGER_TYPE_FINI;
+	slurm_mutex_unlock(&trigger_mutex);
+}
+
 extern void trigger_burst_buffer(void)
 {
 	slurm_mutex_lock(&trigger_mutex);
 	trigger_bb_error = true;
+	trigger_events |= TRIGGER_TYPE_BURST_BUFFER;
 	slurm_mutex_unlock(&trigger_mutex);
 }
 
@@ -798,6 +919,7 @@ static int _load_trigger_state(Buf buffer, uint16_t protocol_version)
 	if (trigger_list == NULL)
 		trigger_list = list_create(_trig_del);
 	list_append(trigger_list, trig_ptr);
+	_trig_subscribe(trig_ptr);
 	next_trigger_id = MAX(next_trigger_id, trig_ptr->trig_id + 1);
 	slurm_mutex_unlock(&trigger_mutex);
 
@@ -959,8 +1081,11 @@ extern void trigger_state_restore(void)
 	xfree(ver_str);
 
 	safe_unpack_time(&buf_time, buffer);
+	slurm_mutex_lock(&trigger_mutex);
+	_trig_sub_flush();
 	if (trigger_list)
 		list_flush(trigger_list);
+	slurm_mutex_unlock(&trigger_mutex);
 	while (remaining_buf(buffer) > 0) {
 		if (_load_trigger_state(buffer, protocol_version) !=
 		    SLURM_SUCCESS)
@@ -1588,6 +1713,7 @@ static void _clear_event_triggers(void)
 	trigger_pri_dbd_res_op = false;
 	trigger_pri_db_fail = false;
 	trigger_pri_db_res_op = false;
+	trigger_events = 0;
 }
 
 /* Make a copy of a trigger and pre-pend it on our list */
@@ -1616,45 +1742,128 @@ static void _trigger_clone(trig_mgr_info_t *trig_in)
 	trig_add->group_id  = trig_in->group_id;
 	trig_add->program   = xstrdup(trig_in->program);;
 	list_prepend(trigger_list, trig_add);
+	_trig_subscribe(trig_add);
 }
 
-extern void trigger_process(void)
+extern bool trigger_event_pending(time_t now)
+{
+	bool rc = false;
+	int i;
+
+	slurm_mutex_lock(&trigger_mutex);
+	if (trig_next_time && (trig_next_time <= now))
+		rc = true;
+	for (i = 0; !rc && trigger_events && (i < TRIG_SUB_CNT); i++) {
+		/* Events without subscribers wait for the periodic pass */
+		if ((trigger_events & (1 << i)) && trig_sub_list[i] &&
+		    !list_is_empty(trig_sub_list[i]))
+			rc = true;
+	}
+	slurm_mutex_unlock(&trigger_mutex);
+
+	return rc;
+}
+
+/* Test a pending trigger for its event, change trigger state as needed */
+static void _trigger_event(trig_mgr_info_t *trig_in, time_t now)
+{
+	if (trig_in->res_type == TRIGGER_RES_TYPE_OTHER)
+		_trigger_other_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_JOB)
+		_trigger_job_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_NODE)
+		_trigger_node_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_SLURMCTLD)
+		_trigger_slurmctld_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_SLURMDBD)
+		_trigger_slurmdbd_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_DATABASE)
+		_trigger_database_event(trig_in, now);
+	else if (trig_in->res_type == TRIGGER_RES_TYPE_FRONT_END)
+		_trigger_front_end_event(trig_in, now);
+}
+
+/* Reap a trigger's program if it has exited */
+static void _trigger_reap_program(trig_mgr_info_t *trig_in)
+{
+	pid_t rc;
+	int prog_stat;
+
+	if (trig_in->child_pid == 0)
+		return;
+
+	rc = waitpid(trig_in->child_pid, &prog_stat, WNOHANG);
+	if ((rc > 0) && prog_stat) {
+		info("trigger uid=%u type=%s:%s exit=%u:%u",
+		     trig_in->user_id,
+		     trigger_res_type(trig_in->res_type),
+		     trigger_type(trig_in->trig_type),
+		     WIFEXITED(prog_stat),
+		     WTERMSIG(prog_stat));
+	}
+	if ((rc == trig_in->child_pid) ||
+	    ((rc == -1) && (errno == ECHILD))) {
+		trig_in->child_pid = 0;
+		trig_prog_cnt--;
+	}
+}
+
+extern void trigger_process(bool periodic)
 {
 	ListIterator trig_iter;
 	trig_mgr_info_t *trig_in;
+	List pulled_list = NULL;
 	time_t now = time(NULL);
 	bool state_change = false;
-	pid_t rc;
-	int prog_stat;
+	uint32_t events;
+	int i;
 
 	slurm_mutex_lock(&trigger_mutex);
 	if (trigger_list == NULL)
 		trigger_list = list_create(_trig_del);
 
-	trig_iter = list_iterator_create(trigger_list);
-	while ((trig_in = list_next(trig_iter))) {
-		if (trig_in->state == 0) {
-			if (trig_in->res_type == TRIGGER_RES_TYPE_OTHER)
-				_trigger_other_event(trig_in, now);
-			else if (trig_in->res_type == TRIGGER_RES_TYPE_JOB)
-				_trigger_job_event(trig_in, now);
-			else if (trig_in->res_type == TRIGGER_RES_TYPE_NODE)
-				_trigger_node_event(trig_in, now);
-			else if (trig_in->res_type ==
-				 TRIGGER_RES_TYPE_SLURMCTLD)
-				_trigger_slurmctld_event(trig_in, now);
-			else if (trig_in->res_type ==
-				 TRIGGER_RES_TYPE_SLURMDBD)
-				_trigger_slurmdbd_event(trig_in, now);
-			else if (trig_in->res_type ==
-				 TRIGGER_RES_TYPE_DATABASE)
-			 	_trigger_database_event(trig_in, now);
-			else if (trig_in->res_type ==
-				 TRIGGER_RES_TYPE_FRONT_END)
-			 	_trigger_front_end_event(trig_in, now);
+	/* Test only the triggers subscribed to the events which occurred */
+	events = trigger_events;
+	if (periodic)
+		events |= TRIGGER_TYPE_TIMED;
+	for (i = 0; i < TRIG_SUB_CNT; i++) {
+		if (!(events & (1 << i)) || !trig_sub_list[i])
+			continue;
+		trig_iter = list_iterator_create(trig_sub_list[i]);
+		while ((trig_in = list_next(trig_iter))) {
+			if (trig_in->state != 0)  /* pulled by earlier event */
+				continue;
+			_trigger_event(trig_in, now);
+			if (trig_in->state == 0)
+				continue;
+			if (!pulled_list)
+				pulled_list = list_create(NULL);
+			list_append(pulled_list, trig_in);
+		}
+		list_iterator_destroy(trig_iter);
+	}
+	if (pulled_list) {
+		/* Move pulled triggers from subscriptions to active list */
+		while ((trig_in = list_pop(pulled_list))) {
+			_trig_unsubscribe(trig_in);
+			_trig_subscribe(trig_in);
 		}
+		FREE_NULL_LIST(pulled_list);
+		state_change = true;
+	}
+
+	trig_next_time = 0;
+	if (!trig_active_list)
+		goto fini;
+	trig_iter = list_iterator_create(trig_active_list);
+	while ((trig_in = list_next(trig_iter))) {
 		if ((trig_in->state == 1) &&
-		    (trig_in->trig_time <= now)) {
+		    (trig_in->trig_time <= now) &&
+		    (trig_prog_cnt >= MAX_PROG_CNT)) {
+			/* Wait for a running trigger program to exit */
+			trig_next_time = now;
+		} else if ((trig_in->state == 1) &&
+			   (trig_in->trig_time <= now)) {
 			if (slurmctld_conf.debug_flags & DEBUG_FLAG_TRIGGERS) {
 				info("launching program for trigger[%u]",
 				     trig_in->trig_id);
@@ -1669,25 +1878,18 @@ extern void trigger_process(void)
 			trig_in->trig_time = now;
 			state_change = true;
 			_trigger_run_program(trig_in);
+			if (trig_in->child_pid)
+				trig_prog_cnt++;
+		} else if (trig_in->state == 1) {
+			if (!trig_next_time ||
+			    (trig_in->trig_time < trig_next_time))
+				trig_next_time = trig_in->trig_time;
 		} else if ((trig_in->state == 2) &&
 			   (difftime(now, trig_in->trig_time) >
 			    MAX_PROG_TIME)) {
 			if (trig_in->child_pid != 0) {
 				killpg(trig_in->child_pid, SIGKILL);
-				rc = waitpid(trig_in->child_pid, &prog_stat,
-					     WNOHANG);
-				if ((rc > 0) && prog_stat) {
-					info("trigger uid=%u type=%s:%s "
-					     "exit=%u:%u",
-					     trig_in->user_id,
-					     trigger_res_type(trig_in->res_type),
-					     trigger_type(trig_in->trig_type),
-					     WIFEXITED(prog_stat),
-					     WTERMSIG(prog_stat));
-				}
-				if ((rc == trig_in->child_pid) ||
-				    ((rc == -1) && (errno == ECHILD)))
-					trig_in->child_pid = 0;
+				_trigger_reap_program(trig_in);
 			}
 
 			if (trig_in->child_pid == 0) {
@@ -1696,27 +1898,21 @@ extern void trigger_process(void)
 					info("purging trigger[%u]",
 					     trig_in->trig_id);
 				}
-				list_delete_item(trig_iter);
+				list_remove(trig_iter);
+				(void) list_delete_all(trigger_list,
+						       _find_trig_ptr,
+						       trig_in);
 				state_change = true;
 			}
 		} else if (trig_in->state == 2) {
 			/* Elimiate zombie processes right away.
 			 * Purge trigger entry above MAX_PROG_TIME later */
-			rc = waitpid(trig_in->child_pid, &prog_stat, WNOHANG);
-			if ((rc > 0) && prog_stat) {
-				info("trigger uid=%u type=%s:%s exit=%u:%u",
-				     trig_in->user_id,
-				     trigger_res_type(trig_in->res_type),
-				     trigger_type(trig_in->trig_type),
-				     WIFEXITED(prog_stat),
-				     WTERMSIG(prog_stat));
-			}
-			if ((rc == trig_in->child_pid) ||
-			    ((rc == -1) && (errno == ECHILD)))
-				trig_in->child_pid = 0;
+			_trigger_reap_program(trig_in);
 		}
 	}
 	list_iterator_destroy(trig_iter);
+
+fini:
 	_clear_event_triggers();
 	slurm_mutex_unlock(&trigger_mutex);
 	if (state_change)
@@ -1726,6 +1922,7 @@ extern void trigger_process(void)
 /* Free all allocated memory */
 extern void trigger_fini(void)
 {
+	_trig_sub_flush();
 	FREE_NULL_LIST(trigger_list);
 	FREE_NULL_BITMAP(trigger_down_front_end_bitmap);
 	FREE_NULL_BITMAP(trigger_up_front_end_bitmap);
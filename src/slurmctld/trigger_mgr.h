@@ -58,6 +58,7 @@ extern void trigger_block_error(void);
 extern void trigger_burst_buffer(void);
 extern void trigger_front_end_down(front_end_record_t *front_end_ptr);
 extern void trigger_front_end_up(front_end_record_t *front_end_ptr);
+extern void trigger_job_fini(void);
 extern void trigger_node_down(struct node_record *node_ptr);
 extern void trigger_node_drained(struct node_record *node_ptr);
 extern void trigger_node_failing(struct node_record *node_ptr);
@@ -82,8 +83,13 @@ extern void trigger_state_restore(void);
 /* Free all allocated memory */
 extern void trigger_fini(void);
 
-/* Execute programs as needed for triggers that have been pulled
- * and purge any vestigial trigger records */
-extern void trigger_process(void);
+/* Return true if events have been noted or pulled triggers are due to run
+ * since the last trigger_process() call */
+extern bool trigger_event_pending(time_t now);
+
+/* Test the triggers subscribed to events noted since the last call, and those
+ * which depend upon time if "periodic" is set. Execute programs as needed for
+ * triggers that have been pulled and purge any vestigial trigger records */
+extern void trigger_process(bool periodic);
 
 #endif /* !_HAVE_TRIGGERS_H */
@@ -0,0 +1,77 @@
+/*
+ * Test of src/common/tres_vec.h
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdlib.h>
+#include <src/common/tres_vec.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define TRES_CNT 5
+
+int main(int argc, char *argv[])
+{
+	uint64_t a[TRES_CNT]     = { 1, 2, 3, 4, 5 };
+	uint64_t b[TRES_CNT]     = { 10, 20, 30, 40, 50 };
+	uint64_t limit[TRES_CNT] = { 10, INFINITE64, 5, 0, 8 };
+	uint64_t used[TRES_CNT]  = { 4, 100, 9, 0, 2 };
+	uint64_t avail[TRES_CNT];
+	int i;
+
+	note("Testing tres_avail");
+	TEST(tres_avail(INFINITE64, 5) == INFINITE64, "no limit");
+	TEST(tres_avail(10, 4) == 7, "under limit");
+	TEST(tres_avail(10, 10) == 1, "at limit");
+	TEST(tres_avail(10, 11) == 0, "over limit");
+	TEST(tres_avail(0, 0) == 1, "zero limit");
+
+	note("Testing tres_vec_add/tres_vec_sub");
+	tres_vec_add(b, a, TRES_CNT);
+	TEST(b[0] == 11 && b[2] == 33 && b[4] == 55, "tres_vec_add");
+	tres_vec_sub(b, a, TRES_CNT);
+	TEST(b[0] == 10 && b[2] == 30 && b[4] == 50, "tres_vec_sub");
+	tres_vec_add(b, a, 0);
+	TEST(b[0] == 10, "tres_vec_add with zero count");
+
+	note("Testing tres_vec_le");
+	TEST(tres_vec_le(a, b, TRES_CNT), "all less");
+	TEST(!tres_vec_le(b, a, TRES_CNT), "all greater");
+	TEST(tres_vec_le(a, a, TRES_CNT), "all equal");
+	a[3] = 41;
+	TEST(!tres_vec_le(a, b, TRES_CNT), "one greater");
+	TEST(tres_vec_le(a, b, 3), "greater element past count");
+
+	note("Testing tres_vec_min_avail");
+	for (i = 0; i < TRES_CNT; i++)
+		avail[i] = INFINITE64;
+	tres_vec_min_avail(avail, limit, used, TRES_CNT);
+	for (i = 0; i < TRES_CNT; i++) {
+		if (avail[i] != tres_avail(limit[i], used[i]))
+			break;
+	}
+	TEST(i == TRES_CNT, "matches tres_avail");
+	TEST(avail[1] == INFINITE64, "no limit");
+	TEST(avail[2] == 0, "over limit");
+	TEST(avail[3] == 1, "zero limit");
+
+	avail[0] = 3;
+	avail[4] = 100;
+	tres_vec_min_avail(avail, limit, used, TRES_CNT);
+	TEST(avail[0] == 3, "keeps smaller avail");
+	TEST(avail[4] == 7, "takes smaller room");
+
+	totals();
+	return failed;
+}